@@ -7,32 +7,41 @@
 C_SRCS += \
 ../Src/app.c \
 ../Src/bemf_pll.c \
+../Src/bench.c \
 ../Src/encoder.c \
 ../Src/firmware.c \
 ../Src/foc.c \
 ../Src/main.c \
+../Src/mtpa.c \
 ../Src/syscalls.c \
-../Src/sysmem.c 
+../Src/sysmem.c \
+../Src/trig.c 
 
 OBJS += \
 ./Src/app.o \
 ./Src/bemf_pll.o \
+./Src/bench.o \
 ./Src/encoder.o \
 ./Src/firmware.o \
 ./Src/foc.o \
 ./Src/main.o \
+./Src/mtpa.o \
 ./Src/syscalls.o \
-./Src/sysmem.o 
+./Src/sysmem.o \
+./Src/trig.o 
 
 C_DEPS += \
 ./Src/app.d \
 ./Src/bemf_pll.d \
+./Src/bench.d \
 ./Src/encoder.d \
 ./Src/firmware.d \
 ./Src/foc.d \
 ./Src/main.d \
+./Src/mtpa.d \
 ./Src/syscalls.d \
-./Src/sysmem.d 
+./Src/sysmem.d \
+./Src/trig.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -42,7 +51,7 @@ Src/%.o Src/%.su Src/%.cyclo: ../Src/%.c Src/subdir.mk
 clean: clean-Src
 
 clean-Src:
-	-$(RM) ./Src/app.cyclo ./Src/app.d ./Src/app.o ./Src/app.su ./Src/bemf_pll.cyclo ./Src/bemf_pll.d ./Src/bemf_pll.o ./Src/bemf_pll.su ./Src/encoder.cyclo ./Src/encoder.d ./Src/encoder.o ./Src/encoder.su ./Src/firmware.cyclo ./Src/firmware.d ./Src/firmware.o ./Src/firmware.su ./Src/foc.cyclo ./Src/foc.d ./Src/foc.o ./Src/foc.su ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su
+	-$(RM) ./Src/app.cyclo ./Src/app.d ./Src/app.o ./Src/app.su ./Src/bemf_pll.cyclo ./Src/bemf_pll.d ./Src/bemf_pll.o ./Src/bemf_pll.su ./Src/bench.cyclo ./Src/bench.d ./Src/bench.o ./Src/bench.su ./Src/encoder.cyclo ./Src/encoder.d ./Src/encoder.o ./Src/encoder.su ./Src/firmware.cyclo ./Src/firmware.d ./Src/firmware.o ./Src/firmware.su ./Src/foc.cyclo ./Src/foc.d ./Src/foc.o ./Src/foc.su ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/mtpa.cyclo ./Src/mtpa.d ./Src/mtpa.o ./Src/mtpa.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/trig.cyclo ./Src/trig.d ./Src/trig.o ./Src/trig.su
 
 .PHONY: clean-Src
 
@@ -0,0 +1,122 @@
+/* cmsis_compiler.h（ホスト用）
+ * 目的：
+ *   BLDC_Lib が使う Cortex-M4 DSP 命令の CMSIS 組み込み関数を、
+ *   ARMv7-M アーキテクチャリファレンスマニュアルの命令定義どおりに C で再現する。
+ *   ホストで Q16_BACKEND_DSP 側の経路をコンパイル・実行し、*_ref / C 実装と突き合わせるためのもの。
+ * 注意：
+ *   Host/ の DSP 経路ビルド（-D__ARM_FEATURE_DSP=1）だけがインクルードする。実機は Inc/Sys の CMSIS を使う。
+ *   定義は命令の擬似コードから直接書き、BLDC_Lib の C 実装は流用しない（同じ誤りを共有しないため）。
+ */
+#ifndef HOST_CMSIS_COMPILER_H
+#define HOST_CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+
+/* 符号付き n bit 範囲 [-2^(n-1), 2^(n-1)-1] へ飽和（SSAT） */
+static inline int32_t __SSAT(int32_t x, uint32_t n)
+{
+	int64_t hi = ((int64_t) 1 << (n - 1)) - 1;
+	int64_t lo = -((int64_t) 1 << (n - 1));
+	if ((int64_t) x > hi)
+		return (int32_t) hi;
+	if ((int64_t) x < lo)
+		return (int32_t) lo;
+	return x;
+}
+
+static inline int32_t host_sat32(int64_t x)
+{
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return (int32_t) x;
+}
+
+static inline int32_t host_sat16(int32_t x)
+{
+	if (x > INT16_MAX)
+		return INT16_MAX;
+	if (x < INT16_MIN)
+		return INT16_MIN;
+	return x;
+}
+
+/* 32bit 飽和加減算（QADD / QSUB） */
+static inline int32_t __QADD(int32_t a, int32_t b)
+{
+	return host_sat32((int64_t) a + (int64_t) b);
+}
+
+static inline int32_t __QSUB(int32_t a, int32_t b)
+{
+	return host_sat32((int64_t) a - (int64_t) b);
+}
+
+/* 下位 16bit レーンと上位 16bit レーンの取り出し（符号付き） */
+static inline int32_t host_lane_lo(uint32_t x)
+{
+	return (int32_t) (int16_t) (uint16_t) (x & 0xFFFFu);
+}
+
+static inline int32_t host_lane_hi(uint32_t x)
+{
+	return (int32_t) (int16_t) (uint16_t) (x >> 16);
+}
+
+static inline uint32_t host_lanes(int32_t lo, int32_t hi)
+{
+	return ((uint32_t) lo & 0xFFFFu) | (((uint32_t) hi & 0xFFFFu) << 16);
+}
+
+/* PKHBT：下位半語は a, 上位半語は (b << sh) の上位半語 */
+static inline uint32_t __PKHBT(uint32_t a, uint32_t b, uint32_t sh)
+{
+	return (a & 0x0000FFFFu) | ((b << sh) & 0xFFFF0000u);
+}
+
+/* レーンごとの 16bit 飽和加減算（QADD16 / QSUB16） */
+static inline uint32_t __QADD16(uint32_t a, uint32_t b)
+{
+	return host_lanes(host_sat16(host_lane_lo(a) + host_lane_lo(b)),
+			host_sat16(host_lane_hi(a) + host_lane_hi(b)));
+}
+
+static inline uint32_t __QSUB16(uint32_t a, uint32_t b)
+{
+	return host_lanes(host_sat16(host_lane_lo(a) - host_lane_lo(b)),
+			host_sat16(host_lane_hi(a) - host_lane_hi(b)));
+}
+
+/* 16×16 の積2つの和/差。結果は下位 32bit（オーバーフロー時は Q フラグが立つだけで折り返す） */
+static inline uint32_t __SMUAD(uint32_t a, uint32_t b)
+{
+	int64_t r = (int64_t) host_lane_lo(a) * host_lane_lo(b)
+			+ (int64_t) host_lane_hi(a) * host_lane_hi(b);
+	return (uint32_t) r;
+}
+
+static inline uint32_t __SMUADX(uint32_t a, uint32_t b)
+{
+	int64_t r = (int64_t) host_lane_lo(a) * host_lane_hi(b)
+			+ (int64_t) host_lane_hi(a) * host_lane_lo(b);
+	return (uint32_t) r;
+}
+
+static inline uint32_t __SMUSD(uint32_t a, uint32_t b)
+{
+	int64_t r = (int64_t) host_lane_lo(a) * host_lane_lo(b)
+			- (int64_t) host_lane_hi(a) * host_lane_hi(b);
+	return (uint32_t) r;
+}
+
+static inline uint32_t __SMUSDX(uint32_t a, uint32_t b)
+{
+	int64_t r = (int64_t) host_lane_lo(a) * host_lane_hi(b)
+			- (int64_t) host_lane_hi(a) * host_lane_lo(b);
+	return (uint32_t) r;
+}
+
+
+#endif
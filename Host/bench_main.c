@@ -0,0 +1,154 @@
+/* bench_main.c
+ * 目的：
+ *   Src/bench.c をホストで実行し、結果を CSV に書き出す。
+ *   基準 CSV を渡すと、行名ごとに実行時間と最大誤差を比べて悪化した行を報告する。
+ * 使い方：
+ *   bench_host [-o 出力.csv] [-b 基準.csv] [-t 許容する時間増加 %]
+ *   -o を省略すると標準出力へ書く。
+ * 終了コード：
+ *   0 = すべて精度上限内かつ基準から悪化なし, 1 = それ以外, 2 = 引数・ファイルの誤り
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define BENCH_CSV_HEADER	"name,n_ops,ns_per_op,ticks_per_op,sat_rate,max_err_lsb,rms_err_lsb,max_err_limit_lsb,status"
+
+
+static void bench_write_csv(FILE *fp)
+{
+	fprintf(fp, "%s\n", BENCH_CSV_HEADER);
+	for (uint32_t i = 0; i < g_bench.count; i++)
+	{
+		const BenchResult_t *r = &g_bench.results[i];
+		fprintf(fp, "%s,%lu,%.3f,%.3f,%.6f,%.6f,%.6f,%.3f,%s\n", r->name,
+				(unsigned long) r->n_ops, r->ns_per_op, r->ticks_per_op,
+				r->sat_rate, r->max_err_lsb, r->rms_err_lsb,
+				r->max_err_limit_lsb,
+				(g_bench.fail_mask & (1u << i)) ? "FAIL" : "ok");
+	}
+}
+
+static const BenchResult_t* bench_find(const char *name)
+{
+	for (uint32_t i = 0; i < g_bench.count; i++)
+	{
+		if (strcmp(g_bench.results[i].name, name) == 0)
+			return &g_bench.results[i];
+	}
+	return NULL;
+}
+
+/* 基準 CSV との比較。悪化した行数を返す（読めなければ -1） */
+static int bench_compare(const char *path, double tol_pct)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+		return -1;
+
+	char line[256];
+	int worse = 0;
+	if (fgets(line, sizeof(line), fp) == NULL)
+	{
+		fclose(fp);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char name[32];
+		unsigned long n_ops;
+		double ns, ticks, sat, max_err;
+		if (sscanf(line, "%31[^,],%lu,%lf,%lf,%lf,%lf", name, &n_ops, &ns,
+				&ticks, &sat, &max_err) != 6)
+			continue;
+
+		const BenchResult_t *r = bench_find(name);
+		if (r == NULL)
+		{
+			fprintf(stderr, "bench: %-16s missing (in baseline)\n", name);
+			worse++;
+			continue;
+		}
+		/* 誤差は決定的なので少しでも増えたら悪化、時間は揺らぎがあるので許容幅を持たせる */
+		if (r->max_err_lsb > max_err + 1.0e-6)
+		{
+			fprintf(stderr, "bench: %-16s max_err %.3f -> %.3f LSB\n", name,
+					max_err, r->max_err_lsb);
+			worse++;
+		}
+		if (ns > 0.0 && r->ns_per_op > ns * (1.0 + tol_pct / 100.0))
+		{
+			fprintf(stderr, "bench: %-16s %.2f -> %.2f ns/op (+%.0f%%)\n",
+					name, ns, r->ns_per_op, (r->ns_per_op / ns - 1.0) * 100.0);
+			worse++;
+		}
+	}
+	fclose(fp);
+	return worse;
+}
+
+int main(int argc, char **argv)
+{
+	const char *out_path = NULL;
+	const char *base_path = NULL;
+	double tol_pct = 25.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			out_path = argv[++i];
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			base_path = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			tol_pct = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-o out.csv] [-b baseline.csv] [-t tol_pct]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+
+	BENCH_Run();
+
+	FILE *fp = stdout;
+	if (out_path != NULL)
+	{
+		fp = fopen(out_path, "w");
+		if (fp == NULL)
+		{
+			perror(out_path);
+			return 2;
+		}
+	}
+	bench_write_csv(fp);
+	if (fp != stdout)
+		fclose(fp);
+
+	int rc = 0;
+	for (uint32_t i = 0; i < g_bench.count; i++)
+	{
+		if (g_bench.fail_mask & (1u << i))
+		{
+			const BenchResult_t *r = &g_bench.results[i];
+			fprintf(stderr, "bench: %-16s max_err %.3f LSB > limit %.3f\n",
+					r->name, r->max_err_lsb, r->max_err_limit_lsb);
+			rc = 1;
+		}
+	}
+	if (base_path != NULL)
+	{
+		int worse = bench_compare(base_path, tol_pct);
+		if (worse < 0)
+		{
+			perror(base_path);
+			return 2;
+		}
+		if (worse > 0)
+			rc = 1;
+	}
+	return rc;
+}
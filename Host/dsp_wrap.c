@@ -0,0 +1,124 @@
+/* dsp_wrap.c
+ * 目的：
+ *   fixed_q16 / q15x2 / vec_q16 の static inline 関数を外部リンクの名前で公開する（test_q16_dsp 用）。
+ * 注意：
+ *   同じソースを2回コンパイルする（Host/Makefile）。
+ *     DSP 経路：-D__ARM_FEATURE_DSP=1 -DDSP_WRAP_PREFIX=dsp_（組み込み関数は Host/Inc の再現版）
+ *     C 経路  ：-DDSP_WRAP_PREFIX=ref_
+ */
+
+#include "dsp_wrap.h"
+
+
+#ifndef DSP_WRAP_PREFIX
+#error "DSP_WRAP_PREFIX を dsp_ または ref_ で指定する"
+#endif
+#if defined(__ARM_FEATURE_DSP) && !Q16_BACKEND_DSP
+#error "DSP 経路のビルドで Q16_BACKEND_DSP が選ばれていない（config.h の CONF_Q16_USE_DSP を確認）"
+#endif
+
+#define WRAP_CAT2(a, b)		a##b
+#define WRAP_CAT(a, b)		WRAP_CAT2(a, b)
+#define WRAP(name)			WRAP_CAT(DSP_WRAP_PREFIX, name)
+
+
+int WRAP(backend)(void)
+{
+	return Q16_BACKEND_DSP;
+}
+
+q16_t WRAP(q16_mul)(q16_t a, q16_t b)
+{
+	return q16_mul(a, b);
+}
+
+q16_t WRAP(q16_add_sat)(q16_t a, q16_t b)
+{
+	return q16_add_sat(a, b);
+}
+
+q16_t WRAP(q16_sub_sat)(q16_t a, q16_t b)
+{
+	return q16_sub_sat(a, b);
+}
+
+q15_t WRAP(q15_sat)(int32_t x)
+{
+	return q15_sat(x);
+}
+
+q15x2_t WRAP(q15x2_pack)(q15_t lo, q15_t hi)
+{
+	return q15x2_pack(lo, hi);
+}
+
+q15x2_t WRAP(q15x2_qadd)(q15x2_t a, q15x2_t b)
+{
+	return q15x2_qadd(a, b);
+}
+
+q15x2_t WRAP(q15x2_qsub)(q15x2_t a, q15x2_t b)
+{
+	return q15x2_qsub(a, b);
+}
+
+int32_t WRAP(q15x2_smuad)(q15x2_t a, q15x2_t b)
+{
+	return q15x2_smuad(a, b);
+}
+
+int32_t WRAP(q15x2_smuadx)(q15x2_t a, q15x2_t b)
+{
+	return q15x2_smuadx(a, b);
+}
+
+int32_t WRAP(q15x2_smusd)(q15x2_t a, q15x2_t b)
+{
+	return q15x2_smusd(a, b);
+}
+
+int32_t WRAP(q15x2_smusdx)(q15x2_t a, q15x2_t b)
+{
+	return q15x2_smusdx(a, b);
+}
+
+q15x2_t WRAP(q15x2_from_adc12)(uint32_t counts, uint16_t mid)
+{
+	return q15x2_from_adc12(counts, mid);
+}
+
+q15x2_t WRAP(clarke_q15x2)(q15x2_t ab)
+{
+	return clarke_q15x2(ab);
+}
+
+q15x2_t WRAP(park_q15x2)(q15x2_t alphabeta, q15x2_t cs)
+{
+	return park_q15x2(alphabeta, cs);
+}
+
+q15x2_t WRAP(inv_park_q15x2)(q15x2_t dq, q15x2_t cs)
+{
+	return inv_park_q15x2(dq, cs);
+}
+
+void WRAP(vec_q16_mul_sat)(q16_t *dst, const q16_t *a, const q16_t *b, size_t n)
+{
+	vec_q16_mul_sat(dst, a, b, n);
+}
+
+void WRAP(vec_q16_scale_add)(q16_t *dst, const q16_t *a, q16_t k,
+		const q16_t *b, size_t n)
+{
+	vec_q16_scale_add(dst, a, k, b, n);
+}
+
+q16_t WRAP(vec_q16_dot)(const q16_t *a, const q16_t *b, size_t n)
+{
+	return vec_q16_dot(a, b, n);
+}
+
+vec_q16_stats_t WRAP(vec_q16_stats)(const q16_t *a, size_t n)
+{
+	return vec_q16_stats(a, n);
+}
@@ -0,0 +1,41 @@
+/* dsp_wrap.h
+ * 目的：
+ *   dsp_wrap.c を DSP 経路（dsp_）と C リファレンス経路（ref_）で2回コンパイルした関数の宣言。
+ */
+#ifndef DSP_WRAP_H
+#define DSP_WRAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fixed_q16.h"
+#include "q15x2.h"
+#include "vec_q16.h"
+
+
+#define DSP_WRAP_DECL(P) \
+	int P##backend(void); \
+	q16_t P##q16_mul(q16_t a, q16_t b); \
+	q16_t P##q16_add_sat(q16_t a, q16_t b); \
+	q16_t P##q16_sub_sat(q16_t a, q16_t b); \
+	q15_t P##q15_sat(int32_t x); \
+	q15x2_t P##q15x2_pack(q15_t lo, q15_t hi); \
+	q15x2_t P##q15x2_qadd(q15x2_t a, q15x2_t b); \
+	q15x2_t P##q15x2_qsub(q15x2_t a, q15x2_t b); \
+	int32_t P##q15x2_smuad(q15x2_t a, q15x2_t b); \
+	int32_t P##q15x2_smuadx(q15x2_t a, q15x2_t b); \
+	int32_t P##q15x2_smusd(q15x2_t a, q15x2_t b); \
+	int32_t P##q15x2_smusdx(q15x2_t a, q15x2_t b); \
+	q15x2_t P##q15x2_from_adc12(uint32_t counts, uint16_t mid); \
+	q15x2_t P##clarke_q15x2(q15x2_t ab); \
+	q15x2_t P##park_q15x2(q15x2_t alphabeta, q15x2_t cs); \
+	q15x2_t P##inv_park_q15x2(q15x2_t dq, q15x2_t cs); \
+	void P##vec_q16_mul_sat(q16_t *dst, const q16_t *a, const q16_t *b, size_t n); \
+	void P##vec_q16_scale_add(q16_t *dst, const q16_t *a, q16_t k, const q16_t *b, size_t n); \
+	q16_t P##vec_q16_dot(const q16_t *a, const q16_t *b, size_t n); \
+	vec_q16_stats_t P##vec_q16_stats(const q16_t *a, size_t n);
+
+DSP_WRAP_DECL(dsp_)
+DSP_WRAP_DECL(ref_)
+
+
+#endif
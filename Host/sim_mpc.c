@@ -0,0 +1,180 @@
+/* sim_mpc.c
+ * 目的：
+ *   電流制御方式（SVPWM＋PI / SVPWM＋デッドビート / FCS-MPC）を、インバータ＋モータのモデル（sim_plant.h）で
+ *   Iq 指令のステップに対して比べる：立ち上がり（10→90%）、行き過ぎ、定常の電流誤差、スイッチング回数。
+ * 注意：
+ *   電流はカウンタ頂点で理想標本、新しい CCR は次の周期から効く。デッドタイムと補償は config.h のまま。
+ *   スイッチング回数は上側スイッチ指令の切替回数（3 相合計）を PWM 周期あたりで数える。
+ *   FCS-MPC で上側 2 相以上 ON の周期は下側シャントで 2 相を測れないので、app.c と同じく FOC_PredictCounts を使う。
+ *   変調する方式（PI / デッドビート）は定常誤差と行き過ぎの上限も満たすこと。FCS-MPC は 1 周期 1 ベクトルなので
+ *   この L と PWM 周波数では上限を満たせず（config.h の CUR_CTRL_MPC 参照）、上限との比較は報告のみ。
+ */
+
+#include "foc.h"
+#include "config.h"
+#include "sim_plant.h"
+#include <stdio.h>
+#include <string.h>
+
+
+#define SIM_VBUS_V			12.0
+#define SIM_PRE_S			0.05		/* ステップ前（Iq = 0） */
+#define SIM_POST_S			0.05		/* ステップ後 */
+#define SIM_STEADY_S		0.02		/* 末尾のこの区間で定常誤差を求める */
+#define SIM_IQ_STEP_A		3.0
+#define SIM_RMS_MAX_A		(0.1 * SIM_IQ_STEP_A)	/* 定常の電流誤差（RMS）の上限 */
+#define SIM_OVERSHOOT_MAX	0.10					/* 行き過ぎの上限 */
+
+typedef struct
+{
+	double rise_periods;	/* 10 → 90% [PWM 周期]（届かなければ負） */
+	double overshoot;		/* 最大値 / 指令 - 1 */
+	double rms_err_A;		/* 定常区間の |i_dq - 指令| の RMS */
+	double sw_per_period;	/* 定常区間のスイッチング回数 / PWM 周期 */
+} StepResult_t;
+
+
+static StepResult_t run(uint8_t cur_ctrl, double f_e_hz)
+{
+	static FOC_t foc;
+	SimMotor_t m;
+	SimPwm_t pwm;
+	const uint16_t arr = (uint16_t) TIM1_ARR;
+
+	FOC_Init(&foc);
+	FOC_SetVbus(&foc, Q16_FRAC(12, 1));
+	foc.ss.scale = Q16_ONE;			/* ソフトスタートは飛ばす */
+	foc.decouple = 1;				/* 一定速度から始めるので BEMF の FF が要る（モデルと同じ MOTOR_* を使う） */
+	foc.cur_ctrl = cur_ctrl;
+	sim_motor_init(&m, SIM_VBUS_V, f_e_hz);
+	for (int k = 0; k < 3; k++)
+		pwm.up[k] = pwm.dn[k] = arr / 2;
+	pwm.dead = DTG_TICKS;
+
+	uint32_t n_pre = (uint32_t) (SIM_PRE_S * PWM_FREQ_HZ);
+	uint32_t n_all = n_pre + (uint32_t) (SIM_POST_S * PWM_FREQ_HZ);
+	uint32_t n_steady = n_all - (uint32_t) (SIM_STEADY_S * PWM_FREQ_HZ);
+	int32_t t10 = -1, t90 = -1;
+	double iq_max = 0.0, e2 = 0.0;
+	uint32_t n_e2 = 0, n_sw = 0;
+	int prev_cmd[3] = { 0, 0, 0 };
+
+	for (uint32_t n = 0; n < n_all; n++)
+	{
+		if (n == n_pre)
+			foc.Iq_ref_q16 = (q16_t) lround(SIM_IQ_STEP_A / CONFIG_I_MAX_A * 65536.0);
+
+		/* 上側スイッチ指令の切替を数える（周期の境目をまたぐ変化も含める） */
+		if (n >= n_steady)
+		{
+			for (int32_t t = 0; t < 2 * TIM1_ARR; t += SIM_SUB)
+			{
+				int h;
+				int32_t cnt = sim_cnt(t, &h);
+				for (int k = 0; k < 3; k++)
+				{
+					int cmd = cnt < (h ? pwm.dn[k] : pwm.up[k]);
+					n_sw += (cmd != prev_cmd[k]);
+					prev_cmd[k] = cmd;
+				}
+			}
+		}
+
+		sim_run(&m, &pwm, 0, TIM1_ARR);
+
+		double i[3];
+		sim_motor_iabc(&m, i);
+		if (n >= n_pre)
+		{
+			int32_t k = (int32_t) (n - n_pre);
+			if (t10 < 0 && m.iq >= 0.1 * SIM_IQ_STEP_A)
+				t10 = k;
+			if (t90 < 0 && m.iq >= 0.9 * SIM_IQ_STEP_A)
+				t90 = k;
+			iq_max = fmax(iq_max, m.iq);
+		}
+		if (n >= n_steady)
+		{
+			e2 += (m.iq - SIM_IQ_STEP_A) * (m.iq - SIM_IQ_STEP_A) + m.id * m.id;
+			n_e2++;
+		}
+
+		RotorFrame_t f;
+		rotor_frame_update(&f, sim_turn32(m.theta),
+				(int32_t) lround(f_e_hz / PWM_FREQ_HZ * 4294967296.0));
+		/* app.c と同じ：FCS-MPC で 2 相を測れない周期はモデル予測 */
+		uint32_t counts = (cur_ctrl == CUR_CTRL_MPC && !foc.sense_valid) ?
+				FOC_PredictCounts(&foc, &f) :
+				FOC_SenseCounts(&foc, sim_adc_counts(i[0]), sim_adc_counts(i[1]),
+						sim_adc_counts(i[2]));
+		FOC_Pwm_t out;
+		FOC_StepFromAdc(&foc, counts, &f, arr, &out);
+
+		sim_run(&m, &pwm, TIM1_ARR, 2 * TIM1_ARR);
+
+		pwm.up[0] = pwm.dn[0] = out.ccr1;
+		pwm.up[1] = pwm.dn[1] = out.ccr2;
+		pwm.up[2] = pwm.dn[2] = out.ccr3;
+	}
+
+	StepResult_t r;
+	r.rise_periods = (t10 >= 0 && t90 >= 0) ? (double) (t90 - t10) : -1.0;
+	r.overshoot = iq_max / SIM_IQ_STEP_A - 1.0;
+	r.rms_err_A = sqrt(e2 / n_e2);
+	r.sw_per_period = (double) n_sw / (n_all - n_steady);
+	return r;
+}
+
+int main(void)
+{
+	static const struct
+	{
+		const char *name;
+		uint8_t mode;
+	} k_modes[] =
+	{
+		{ "svpwm+pi", CUR_CTRL_PI },
+		{ "svpwm+deadbeat", CUR_CTRL_DEADBEAT },
+		{ "fcs-mpc", CUR_CTRL_MPC },
+	};
+	static const double k_f_hz[] = { 50.0, 150.0 };
+	int fails = 0;
+
+	printf("Iq step 0 -> %.1f A, Vbus %.0f V, PWM %d Hz\n", SIM_IQ_STEP_A, SIM_VBUS_V,
+			PWM_FREQ_HZ);
+	printf("%-16s %7s | %12s %9s %12s %12s\n", "mode", "f_e[Hz]", "rise[period]",
+			"overshoot", "rms err[A]", "sw/period");
+	for (size_t a = 0; a < sizeof(k_f_hz) / sizeof(k_f_hz[0]); a++)
+	{
+		StepResult_t r[3];
+		for (size_t b = 0; b < 3; b++)
+		{
+			r[b] = run(k_modes[b].mode, k_f_hz[a]);
+			printf("%-16s %7.0f | %12.0f %8.1f%% %12.3f %12.2f\n", k_modes[b].name,
+					k_f_hz[a], r[b].rise_periods, 100.0 * r[b].overshoot,
+					r[b].rms_err_A, r[b].sw_per_period);
+		}
+		/* 期待：MPC は PI より速く立ち上がり、SVPWM（6 回/周期）より切替が少ない。
+		 * 代わりに定常の電流リプルは変調する方式より大きい */
+		int ok = (r[2].rise_periods >= 0 && r[2].rise_periods <= r[0].rise_periods)
+				&& (r[2].sw_per_period < r[0].sw_per_period)
+				&& (r[0].rise_periods >= 0 && r[1].rise_periods >= 0);
+		for (size_t b = 0; b < 3; b++)
+		{
+			int in_bounds = (r[b].rms_err_A <= SIM_RMS_MAX_A)
+					&& (r[b].overshoot <= SIM_OVERSHOOT_MAX);
+			if (k_modes[b].mode != CUR_CTRL_MPC)
+				ok &= in_bounds;
+			else if (!in_bounds)
+				printf("%s at %.0f Hz: rms %.3f A / overshoot %.1f%% exceed %.2f A / %.0f%% "
+						"(not usable with this L and PWM frequency)\n", k_modes[b].name,
+						k_f_hz[a], r[b].rms_err_A, 100.0 * r[b].overshoot, SIM_RMS_MAX_A,
+						100.0 * SIM_OVERSHOOT_MAX);
+		}
+		fails += !ok;
+		if (!ok)
+			printf("FAIL at %.0f Hz\n", k_f_hz[a]);
+	}
+	printf("sim_mpc: %d speeds failed\n", fails);
+	return (fails == 0) ? 0 : 1;
+}
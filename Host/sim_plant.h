@@ -0,0 +1,148 @@
+/* sim_plant.h
+ * 目的：
+ *   ホストのシミュレーション（sim_*.c）が共有する、インバータ＋モータの連続時間モデル。
+ *   TIM1 のセンターアライン PWM をカウント単位で再現し、デッドタイム中の相電圧は電流の向きで決める。
+ * 注意：
+ *   モータは dq 軸の R-L-ψ モデルで、電気角速度は一定（負荷側が速度を保つ）。定数は config.h の MOTOR_*。
+ *   相電流の向きは相からモータへ流れ込む向きを＋（ADC カウントは中点＋正、CONFIG_I_MAX_A で ±2048）。
+ *   SIM_SUB カウントごとに前進オイラーで積分する（1 PWM 周期 = 2·ARR カウント）。
+ */
+#ifndef SIM_PLANT_H
+#define SIM_PLANT_H
+
+#include <math.h>
+#include <stdint.h>
+#include "config.h"
+
+
+#define SIM_SUB				8										/* 積分の刻み [TIM1 カウント] */
+#define SIM_TICK_S			(1.0 / TIM1_CLK_HZ)
+
+
+typedef struct
+{
+	double R;				/* [Ω] */
+	double Ld;				/* [H] */
+	double Lq;
+	double psi;				/* [Wb] */
+	double vbus;			/* [V] */
+	double w_e;				/* 電気角速度 [rad/s]（一定） */
+	double theta;			/* 電気角 [rad] */
+	double id;				/* [A] */
+	double iq;
+} SimMotor_t;
+
+/* 1 PWM 周期の相ごとの比較値。上り/下りで別の値を使える（単シャントの非対称 PWM） */
+typedef struct
+{
+	int32_t up[3];
+	int32_t dn[3];
+	int32_t dead;			/* デッドタイム [カウント]（0 で理想スイッチ） */
+} SimPwm_t;
+
+
+static inline void sim_motor_init(SimMotor_t *m, double vbus, double f_e_hz)
+{
+	m->R = MOTOR_RS_MOHM * 1e-3;
+	m->Ld = MOTOR_LD_UH * 1e-6;
+	m->Lq = MOTOR_LQ_UH * 1e-6;
+	m->psi = MOTOR_PSI_UWB * 1e-6;
+	m->vbus = vbus;
+	m->w_e = 2.0 * M_PI * f_e_hz;
+	m->theta = 0.0;
+	m->id = 0.0;
+	m->iq = 0.0;
+}
+
+/* dq → 相（U, V, W）。c, s は電気角の cos/sin */
+static inline void sim_dq_to_abc(double d, double q, double c, double s,
+		double x[3])
+{
+	const double h = 0.8660254037844386;
+	x[0] = d * c - q * s;
+	x[1] = d * (-0.5 * c + h * s) - q * (-0.5 * s - h * c);
+	x[2] = d * (-0.5 * c - h * s) - q * (-0.5 * s + h * c);
+}
+
+/* 相電流 iU, iV, iW [A] */
+static inline void sim_motor_iabc(const SimMotor_t *m, double i[3])
+{
+	sim_dq_to_abc(m->id, m->iq, cos(m->theta), sin(m->theta), i);
+}
+
+/* 相の端子電圧（負側バス基準）で dt 秒進める。中性点は浮いているので相電圧は平均を引いたもの */
+static inline void sim_motor_step(SimMotor_t *m, const double v_pole[3], double dt)
+{
+	const double h = 0.8660254037844386;
+	double c = cos(m->theta), s = sin(m->theta);
+	double vn = (v_pole[0] + v_pole[1] + v_pole[2]) / 3.0;
+	double va = (2.0 / 3.0) * ((v_pole[0] - vn) - 0.5 * (v_pole[1] - vn) - 0.5 * (v_pole[2] - vn));
+	double vb = (2.0 / 3.0) * h * ((v_pole[1] - vn) - (v_pole[2] - vn));
+	double vd = va * c + vb * s;
+	double vq = -va * s + vb * c;
+	double did = (vd - m->R * m->id + m->w_e * m->Lq * m->iq) / m->Ld;
+	double diq = (vq - m->R * m->iq - m->w_e * m->Ld * m->id - m->w_e * m->psi) / m->Lq;
+	m->id += did * dt;
+	m->iq += diq * dt;
+	m->theta += m->w_e * dt;
+	if (m->theta >= 2.0 * M_PI)
+		m->theta -= 2.0 * M_PI;
+}
+
+/* カウンタ値 cnt・半周期 h（0 = 上り, 1 = 下り）での相 k の上側スイッチ状態。
+ * 指令は cnt < CCR で上側 ON。デッドタイム中（上り：CCR ≤ cnt < CCR+dead、下り：CCR-dead ≤ cnt < CCR）は
+ * 両側 OFF で、電流が相から流れ出る（i > 0）と下側ダイオード、流れ込むと上側ダイオードが導通する */
+static inline int sim_leg_high(const SimPwm_t *p, int k, int32_t cnt, int h,
+		double i)
+{
+	int32_t c = h ? p->dn[k] : p->up[k];
+	if (c <= 0 || c > TIM1_ARR)
+		return (cnt < c);		/* 周期中ずっと同じ側（切替なし） */
+	int32_t since = h ? (c - 1 - cnt) : (cnt - c);
+	if (since >= 0 && since < p->dead)
+		return (i < 0.0);
+	return (cnt < c);
+}
+
+/* t（周期の先頭＝谷からのカウント, 0..2·ARR-1）のカウンタ値と半周期 */
+static inline int32_t sim_cnt(int32_t t, int *h)
+{
+	*h = (t >= TIM1_ARR);
+	return *h ? (2 * TIM1_ARR - t) : t;
+}
+
+/* t0 から t1 カウントまで（同じ PWM 周期内）インバータ＋モータを進める */
+static inline void sim_run(SimMotor_t *m, const SimPwm_t *p, int32_t t0,
+		int32_t t1)
+{
+	for (int32_t t = t0; t < t1; t += SIM_SUB)
+	{
+		int h;
+		int32_t cnt = sim_cnt(t, &h);
+		double i[3], v[3];
+		sim_motor_iabc(m, i);
+		for (int k = 0; k < 3; k++)
+			v[k] = sim_leg_high(p, k, cnt, h, i[k]) ? m->vbus : 0.0;
+		int32_t n = (t1 - t < SIM_SUB) ? (t1 - t) : SIM_SUB;
+		sim_motor_step(m, v, n * SIM_TICK_S);
+	}
+}
+
+/* 相電流 [A] → 12bit ADC カウント（中点＋, 飽和） */
+static inline uint16_t sim_adc_counts(double i_A)
+{
+	long c = lround(CONF_I_ADC_MID_COUNTS + i_A * 2048.0 / CONFIG_I_MAX_A);
+	c = (c < 0) ? 0 : ((c > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : c);
+	return (uint16_t) c;
+}
+
+/* 電気角 [rad] → turn32 */
+static inline turn32_t sim_turn32(double rad)
+{
+	double t = rad / (2.0 * M_PI);
+	t -= floor(t);
+	return (turn32_t) (uint32_t) (int64_t) (t * 4294967296.0);
+}
+
+
+#endif
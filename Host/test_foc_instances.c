@@ -0,0 +1,172 @@
+/* test_foc_instances.c
+ * 目的：
+ *   FOC_t を複数インスタンスで交互に回しても、各インスタンスの出力が単独で回した場合と
+ *   ビット単位で一致すること（状態がすべて FOC_t に入っていて、モジュール側に残らないこと）を確かめる。
+ * 注意：
+ *   インスタンスごとに制御方式（PI / デッドビート / FCS-MPC×2）・Vbus・電流指令・ADC 系列を変える。
+ *   呼び出し順は総当たりの順繰りと乱数の2通り。毎周期の CCR と最後の FOC_t 全体を比べる。
+ */
+
+#include "foc.h"
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+
+#define N_INST		4
+#define N_STEPS		20000
+#define VBUS_EVERY	21			/* FOC_SetVbus を呼ぶ間隔（周期） */
+
+typedef struct
+{
+	uint8_t cur_ctrl;
+	q16_t vbus_q16;
+	q16_t id_ref_q16;
+	q16_t iq_ref_q16;
+	turn32_t omega_t32;
+	uint32_t seed;
+} InstCfg_t;
+
+static const InstCfg_t k_cfg[N_INST] =
+{
+	{ CUR_CTRL_PI, Q16_FRAC(12, 1), 0, Q16_FRAC(1, 5), TURN32_FRAC(1, 400), 0x12345678u },
+	{ CUR_CTRL_DEADBEAT, Q16_FRAC(24, 1), -Q16_FRAC(1, 10), Q16_FRAC(3, 10), TURN32_FRAC(1, 150), 0x9E3779B9u },
+	{ CUR_CTRL_MPC, Q16_FRAC(10, 1), 0, -Q16_FRAC(1, 4), (turn32_t) -TURN32_FRAC(1, 700), 0xC0FFEE11u },
+	{ CUR_CTRL_MPC, Q16_FRAC(16, 1), -Q16_FRAC(1, 20), Q16_FRAC(2, 5), TURN32_FRAC(1, 90), 0x0BADF00Du },
+};
+
+typedef struct
+{
+	FOC_t foc;
+	turn32_t theta;
+	uint32_t rng;
+	int32_t walk[3];
+	uint32_t step;
+} Inst_t;
+
+static FOC_Pwm_t s_pwm_solo[N_INST][N_STEPS];
+static uint32_t s_checked;
+static uint32_t s_failed;
+
+
+static uint32_t xorshift(uint32_t *s)
+{
+	uint32_t x = *s;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*s = x;
+	return x;
+}
+
+static void inst_init(Inst_t *p, const InstCfg_t *c)
+{
+	memset(p, 0, sizeof(*p));
+	FOC_Init(&p->foc);
+	p->foc.cur_ctrl = c->cur_ctrl;
+	p->foc.Id_ref_q16 = c->id_ref_q16;
+	p->foc.Iq_ref_q16 = c->iq_ref_q16;
+	FOC_SetVbus(&p->foc, c->vbus_q16);
+	p->rng = c->seed;
+}
+
+/* 1 制御周期：3 相 ADC（中点まわりのランダムウォーク）→ 2 相選択 → 融合カーネル */
+static void inst_step(Inst_t *p, const InstCfg_t *c, FOC_Pwm_t *pwm)
+{
+	for (uint32_t k = 0; k < 3; k++)
+	{
+		p->walk[k] += (int32_t) (xorshift(&p->rng) % 81u) - 40;
+		p->walk[k] = (p->walk[k] > 1500) ? 1500 : ((p->walk[k] < -1500) ? -1500 : p->walk[k]);
+	}
+	if ((p->step % VBUS_EVERY) == 0)
+		FOC_SetVbus(&p->foc, c->vbus_q16 + (q16_t) (xorshift(&p->rng) & 0xFFFFu));
+
+	RotorFrame_t f;
+	rotor_frame_update(&f, p->theta, c->omega_t32);
+	uint32_t counts = FOC_SenseCounts(&p->foc,
+			(uint16_t) (CONF_I_ADC_MID_COUNTS + p->walk[0]),
+			(uint16_t) (CONF_I_ADC_MID_COUNTS + p->walk[1]),
+			(uint16_t) (CONF_I_ADC_MID_COUNTS + p->walk[2]));
+	FOC_StepFromAdc(&p->foc, counts, &f, (uint16_t) TIM1_ARR, pwm);
+	p->theta += (uint32_t) c->omega_t32;
+	p->step++;
+}
+
+static void run_interleaved(const char *name, int random_order,
+		const Inst_t solo_end[N_INST])
+{
+	static Inst_t inst[N_INST];
+	uint32_t sched = 0x2545F491u;
+	uint32_t fail0 = s_failed;
+
+	for (uint32_t n = 0; n < N_INST; n++)
+		inst_init(&inst[n], &k_cfg[n]);
+
+	/* 全インスタンスが N_STEPS 回進むまで、順繰りまたは乱数で選んだインスタンスを1周期進める */
+	uint32_t done = 0, rr = 0;
+	while (done < N_INST)
+	{
+		uint32_t n = random_order ? (xorshift(&sched) % N_INST) : (rr++ % N_INST);
+		Inst_t *p = &inst[n];
+		if (p->step >= N_STEPS)
+			continue;
+		uint32_t t = p->step;
+		FOC_Pwm_t pwm;
+		memset(&pwm, 0, sizeof(pwm));
+		inst_step(p, &k_cfg[n], &pwm);
+		s_checked++;
+		if (memcmp(&pwm, &s_pwm_solo[n][t], sizeof(pwm)) != 0)
+		{
+			if (s_failed - fail0 < 5)
+				printf("MISMATCH %s inst=%lu step=%lu ccr1=%u (solo %u)\n", name,
+						(unsigned long) n, (unsigned long) t, pwm.ccr1,
+						s_pwm_solo[n][t].ccr1);
+			s_failed++;
+		}
+		if (p->step == N_STEPS)
+			done++;
+	}
+	for (uint32_t n = 0; n < N_INST; n++)
+	{
+		s_checked++;
+		if (memcmp(&inst[n].foc, &solo_end[n].foc, sizeof(FOC_t)) != 0)
+		{
+			printf("MISMATCH %s inst=%lu: final FOC_t differs\n", name,
+					(unsigned long) n);
+			s_failed++;
+		}
+	}
+	printf("%-12s %s\n", name, (s_failed == fail0) ? "ok" : "FAIL");
+}
+
+int main(void)
+{
+	static Inst_t solo[N_INST];
+
+	/* 基準：1 インスタンスずつ単独で回す */
+	for (uint32_t n = 0; n < N_INST; n++)
+	{
+		inst_init(&solo[n], &k_cfg[n]);
+		for (uint32_t t = 0; t < N_STEPS; t++)
+		{
+			memset(&s_pwm_solo[n][t], 0, sizeof(FOC_Pwm_t));
+			inst_step(&solo[n], &k_cfg[n], &s_pwm_solo[n][t]);
+		}
+	}
+
+	/* インスタンスの出力が互いに異なること（同じ系列を比べているだけ、を避ける） */
+	if (memcmp(s_pwm_solo[0], s_pwm_solo[1], sizeof(s_pwm_solo[0])) == 0
+			|| memcmp(s_pwm_solo[1], s_pwm_solo[2], sizeof(s_pwm_solo[0])) == 0
+			|| memcmp(s_pwm_solo[2], s_pwm_solo[3], sizeof(s_pwm_solo[0])) == 0)
+	{
+		printf("FAIL: instances produced identical outputs\n");
+		return 1;
+	}
+
+	run_interleaved("round_robin", 0, solo);
+	run_interleaved("random", 1, solo);
+
+	printf("test_foc_instances: %lu checks, %lu mismatches\n",
+			(unsigned long) s_checked, (unsigned long) s_failed);
+	return (s_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/* test_mtpa.c
+ * 目的：
+ *   MTPA_InitMotor のテーブル（Q16.16）を倍精度の MTPA 解と比べる。
+ *     id = (k - √(k² + 8·is²)) / 4,  k = ψ / (Lq - Ld),  iq = √(is² - id²)
+ *   表の節点は Id/Iq の誤差、節点間（線形補間）は同じ |i| での最適トルクに対する比で見る。
+ *   最初の区間（0 → 1/16）は r が小さいほど最適角が急に動くので、補間の比は報告だけにする。
+ * 注意：
+ *   設定値のモータに加え、r = is/k が大きい（磁石が弱い・突極比が大きい）場合、
+ *   ψ = 0（同期リラクタンス）、ほぼ非突極、表面磁石（Lq ≤ Ld）も通す。
+ */
+
+#include "mtpa.h"
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+
+
+#define NODE_ERR_LIMIT_LSB	8.0			/* 節点の Id/Iq 誤差の上限（正規化 Q16 の LSB） */
+#define TORQUE_RATIO_MIN	0.999		/* 節点間のトルク / 最適トルクの下限 */
+#define N_SUB				64			/* 節点間の確認点数 */
+
+typedef struct
+{
+	const char *name;
+	int32_t psi_uwb;
+	int32_t ld_uh;
+	int32_t lq_uh;
+	int32_t i_fs_A;
+} MotorCase_t;
+
+static const MotorCase_t k_cases[] =
+{
+	{ "config", MOTOR_PSI_UWB, MOTOR_LD_UH, MOTOR_LQ_UH, CONFIG_I_MAX_A },
+	{ "config_200A", MOTOR_PSI_UWB, MOTOR_LD_UH, MOTOR_LQ_UH, 200 },
+	{ "salient", 500, 100, 400, CONFIG_I_MAX_A },
+	{ "weak_magnet", 50, 100, 400, CONFIG_I_MAX_A },		/* r = is/k ≈ 66 */
+	{ "weak_magnet_200A", 50, 100, 400, 200 },				/* r ≈ 1200 */
+	{ "synrm", 0, 100, 300, CONFIG_I_MAX_A },
+	{ "near_spm", 5000, 100, 101, CONFIG_I_MAX_A },
+	{ "spm", 5000, 120, 100, CONFIG_I_MAX_A },
+};
+#define N_CASES	(sizeof(k_cases) / sizeof(k_cases[0]))
+
+
+/* 倍精度の MTPA 解（正規化 is → 正規化 id） */
+static double mtpa_id(const MotorCase_t *c, double is)
+{
+	double dl = (double) c->lq_uh - c->ld_uh;
+	if (dl <= 0.0)
+		return 0.0;
+	double k = (double) c->psi_uwb / dl;
+	double is_A = is * c->i_fs_A;
+	return (k - sqrt(k * k + 8.0 * is_A * is_A)) / 4.0 / c->i_fs_A;
+}
+
+static double torque(const MotorCase_t *c, double id, double iq)
+{
+	/* ψ·iq + (Ld - Lq)·id·iq（正規化電流のまま、係数は µWb・µH・A） */
+	double id_A = id * c->i_fs_A, iq_A = iq * c->i_fs_A;
+	return c->psi_uwb * iq_A + ((double) c->ld_uh - c->lq_uh) * id_A * iq_A;
+}
+
+static int check_case(const MotorCase_t *c)
+{
+	MTPA_t m;
+	MTPA_InitMotor(&m, Q16_FRAC(c->i_fs_A, 1), c->psi_uwb, c->ld_uh, c->lq_uh);
+
+	double node_err = 0.0;
+	for (uint32_t i = 0; i < MTPA_N; i++)
+	{
+		double is = (double) i / (MTPA_N - 1);
+		double id = mtpa_id(c, is);
+		double iq = sqrt(is * is - id * id);
+		double e_id = fabs(m.id_q16[i] - id * 65536.0);
+		double e_iq = fabs(m.iq_q16[i] - iq * 65536.0);
+		node_err = fmax(node_err, fmax(e_id, e_iq));
+	}
+
+	double ratio_first = 1.0, ratio_min = 1.0;
+	for (uint32_t j = 1; j <= (MTPA_N - 1) * N_SUB; j++)
+	{
+		double is = (double) j / ((MTPA_N - 1) * N_SUB);
+		q16_t id_q16, iq_q16;
+		MTPA_Lookup(&m, (q16_t) lround(is * 65536.0), &id_q16, &iq_q16);
+		/* 補間は弦になるので |i| が少し縮む。同じ |i| での最適トルクと比べ、角度の誤差だけを見る */
+		double i_mag = hypot(id_q16 / 65536.0, iq_q16 / 65536.0);
+		double id = mtpa_id(c, i_mag);
+		double t_opt = torque(c, id, sqrt(i_mag * i_mag - id * id));
+		double t = torque(c, id_q16 / 65536.0, iq_q16 / 65536.0);
+		if (t_opt <= 0.0)
+			continue;
+		if (j <= N_SUB)
+			ratio_first = fmin(ratio_first, t / t_opt);
+		else
+			ratio_min = fmin(ratio_min, t / t_opt);
+	}
+
+	/* 負の指令は Iq だけ符号が反転すること */
+	q16_t idp, iqp, idn, iqn;
+	MTPA_Lookup(&m, Q16_FRAC(7, 10), &idp, &iqp);
+	MTPA_Lookup(&m, -Q16_FRAC(7, 10), &idn, &iqn);
+	int sym_ok = (idp == idn && iqp == -iqn);
+
+	/* 範囲外の指令は ±1.0 に丸めること（Q16_MIN も符号反転せずに扱う） */
+	q16_t id1, iq1, idx, iqx;
+	MTPA_Lookup(&m, Q16_ONE, &id1, &iq1);
+	MTPA_Lookup(&m, Q16_MAX, &idx, &iqx);
+	sym_ok &= (idx == id1 && iqx == iq1);
+	MTPA_Lookup(&m, Q16_MIN, &idx, &iqx);
+	sym_ok &= (idx == id1 && iqx == -iq1);
+
+	int ok = (node_err <= NODE_ERR_LIMIT_LSB) && (ratio_min >= TORQUE_RATIO_MIN)
+			&& sym_ok;
+	printf("%-18s id(1.0)=%+.5f (exact %+.5f)  node max err %5.2f LSB  "
+			"torque/opt min %.6f (first segment %.6f)  %s\n", c->name,
+			m.id_q16[MTPA_N - 1] / 65536.0, mtpa_id(c, 1.0), node_err, ratio_min,
+			ratio_first, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+int main(void)
+{
+	int fails = 0;
+	for (uint32_t i = 0; i < N_CASES; i++)
+		fails += !check_case(&k_cases[i]);
+	printf("test_mtpa: %u cases, %d failed\n", (unsigned) N_CASES, fails);
+	return (fails == 0) ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/* test_q16_dsp.c
+ * 目的：
+ *   Q16_BACKEND_DSP の経路（SMULL＋SSAT / QADD / QSUB / SIMD 16bit 命令）と
+ *   C リファレンス経路が、すべての入力でビット単位に同じ結果を返すことを確かめる。
+ * 注意：
+ *   DSP 命令は Host/Inc/cmsis_compiler.h の再現版で実行する。
+ *   境界値（Q16_MIN×Q16_MIN, ±オーバーフローの直前/直後, Q15 レーンの端）は総当たり、
+ *   それ以外は大きさが対数的に分布する乱数で検査する。
+ */
+
+#include "dsp_wrap.h"
+#include <stdio.h>
+#include <string.h>
+
+
+#define RAND_PAIRS		(1u << 24)
+#define RAND_LANES		(1u << 22)
+#define VEC_MAX_N		37
+
+static uint32_t s_rng = 0x9E3779B9u;
+static uint32_t s_checked;
+static uint32_t s_failed;
+
+
+static uint32_t rnd(void)
+{
+	/* xorshift32 */
+	uint32_t x = s_rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	s_rng = x;
+	return x;
+}
+
+static int32_t rnd_q16(void)
+{
+	uint32_t sh = rnd() & 31u;
+	return (int32_t) rnd() >> sh;
+}
+
+static void check(const char *name, int64_t got, int64_t ref, int64_t a,
+		int64_t b)
+{
+	s_checked++;
+	if (got == ref)
+		return;
+	if (s_failed < 20)
+		printf("MISMATCH %-14s a=0x%08lx b=0x%08lx dsp=0x%08lx ref=0x%08lx\n",
+				name, (unsigned long) (uint32_t) a, (unsigned long) (uint32_t) b,
+				(unsigned long) (uint32_t) got, (unsigned long) (uint32_t) ref);
+	s_failed++;
+}
+
+/* q16 の二項演算 */
+static void check_q16_pair(q16_t a, q16_t b)
+{
+	check("q16_mul", dsp_q16_mul(a, b), ref_q16_mul(a, b), a, b);
+	check("q16_add_sat", dsp_q16_add_sat(a, b), ref_q16_add_sat(a, b), a, b);
+	check("q16_sub_sat", dsp_q16_sub_sat(a, b), ref_q16_sub_sat(a, b), a, b);
+}
+
+/* q15x2 の二項演算（a, b は2レーンのパック値） */
+static void check_q15x2_pair(q15x2_t a, q15x2_t b)
+{
+	check("q15x2_qadd", dsp_q15x2_qadd(a, b), ref_q15x2_qadd(a, b), a, b);
+	check("q15x2_qsub", dsp_q15x2_qsub(a, b), ref_q15x2_qsub(a, b), a, b);
+	check("q15x2_smuad", dsp_q15x2_smuad(a, b), ref_q15x2_smuad(a, b), a, b);
+	check("q15x2_smuadx", dsp_q15x2_smuadx(a, b), ref_q15x2_smuadx(a, b), a, b);
+	check("q15x2_smusd", dsp_q15x2_smusd(a, b), ref_q15x2_smusd(a, b), a, b);
+	check("q15x2_smusdx", dsp_q15x2_smusdx(a, b), ref_q15x2_smusdx(a, b), a, b);
+	check("park_q15x2", dsp_park_q15x2(a, b), ref_park_q15x2(a, b), a, b);
+	check("inv_park_q15x2", dsp_inv_park_q15x2(a, b), ref_inv_park_q15x2(a, b), a, b);
+	check("clarke_q15x2", dsp_clarke_q15x2(a), ref_clarke_q15x2(a), a, 0);
+}
+
+
+/* Q16：0, ±1LSB, ±0.5, ±1.0, 最大/最小とその隣、積が 2^31 を跨ぐ ±√32768 付近、下位語の丸め境界 */
+static const q16_t k_edge_q16[] =
+{
+	0, 1, -1, Q16_HALF, -Q16_HALF, Q16_ONE, -Q16_ONE,
+	Q16_MAX, Q16_MIN, Q16_MAX - 1, Q16_MIN + 1,
+	0x00B504F3, 0x00B504F4, -0x00B504F3, -0x00B504F4,
+	0x00B50000, -0x00B50000, 0x00B60000, -0x00B60000,
+	0x7FFF0000, -0x7FFF0000, 0x00008000, -0x00008000, 0x00007FFF,
+	0x0000FFFF, 0x00010001, 0x40000000, -0x40000000, 0x3FFFFFFF
+};
+#define N_EDGE_Q16	(sizeof(k_edge_q16) / sizeof(k_edge_q16[0]))
+
+/* Q15 レーン：端と ±1/2, 半端 */
+static const q15_t k_edge_q15[] =
+{
+	0, 1, -1, Q15_MAX, Q15_MIN, Q15_MAX - 1, Q15_MIN + 1, 0x4000, -0x4000, 0x3FFF
+};
+#define N_EDGE_Q15	(sizeof(k_edge_q15) / sizeof(k_edge_q15[0]))
+
+
+static void test_q16(void)
+{
+	/* 境界値の総当たり（±1 隣も含める） */
+	for (uint32_t i = 0; i < N_EDGE_Q16; i++)
+	{
+		for (uint32_t j = 0; j < N_EDGE_Q16; j++)
+		{
+			for (int32_t di = -1; di <= 1; di++)
+			{
+				for (int32_t dj = -1; dj <= 1; dj++)
+				{
+					q16_t a = (q16_t) ((uint32_t) k_edge_q16[i] + (uint32_t) di);
+					q16_t b = (q16_t) ((uint32_t) k_edge_q16[j] + (uint32_t) dj);
+					check_q16_pair(a, b);
+				}
+			}
+		}
+	}
+	/* Q16_MIN×Q16_MIN（正の最大を超える）と ±オーバーフローの代表値は明示的にも確認する */
+	check("q16_mul", dsp_q16_mul(Q16_MIN, Q16_MIN), Q16_MAX, Q16_MIN, Q16_MIN);
+	check("q16_mul", dsp_q16_mul(Q16_MIN, Q16_MAX), Q16_MIN, Q16_MIN, Q16_MAX);
+	check("q16_add_sat", dsp_q16_add_sat(Q16_MAX, 1), Q16_MAX, Q16_MAX, 1);
+	check("q16_sub_sat", dsp_q16_sub_sat(Q16_MIN, 1), Q16_MIN, Q16_MIN, 1);
+
+	for (uint32_t n = 0; n < RAND_PAIRS; n++)
+		check_q16_pair(rnd_q16(), rnd_q16());
+}
+
+static void test_q15x2(void)
+{
+	for (int32_t x = -70000; x <= 70000; x++)
+		check("q15_sat", dsp_q15_sat(x), ref_q15_sat(x), x, 0);
+	check("q15_sat", dsp_q15_sat(INT32_MAX), ref_q15_sat(INT32_MAX), INT32_MAX, 0);
+	check("q15_sat", dsp_q15_sat(INT32_MIN), ref_q15_sat(INT32_MIN), INT32_MIN, 0);
+
+	/* 4 レーンすべての境界値の組み合わせ */
+	for (uint32_t i0 = 0; i0 < N_EDGE_Q15; i0++)
+		for (uint32_t i1 = 0; i1 < N_EDGE_Q15; i1++)
+			for (uint32_t j0 = 0; j0 < N_EDGE_Q15; j0++)
+				for (uint32_t j1 = 0; j1 < N_EDGE_Q15; j1++)
+				{
+					q15x2_t a = dsp_q15x2_pack(k_edge_q15[i0], k_edge_q15[i1]);
+					q15x2_t b = ref_q15x2_pack(k_edge_q15[j0], k_edge_q15[j1]);
+					check("q15x2_pack", a, ref_q15x2_pack(k_edge_q15[i0],
+							k_edge_q15[i1]), k_edge_q15[i0], k_edge_q15[i1]);
+					check_q15x2_pair(a, b);
+				}
+
+	for (uint32_t n = 0; n < RAND_LANES; n++)
+	{
+		q15x2_t a = rnd(), b = rnd();
+		check_q15x2_pair(a, b);
+		q15_t lo = (q15_t) rnd(), hi = (q15_t) rnd();
+		check("q15x2_pack", dsp_q15x2_pack(lo, hi), ref_q15x2_pack(lo, hi), lo, hi);
+	}
+
+	/* 12bit ADC カウント：0..4095 の両端と中点付近を含む総当たり（上位レーンは間引き） */
+	for (uint32_t u = 0; u < 4096; u++)
+	{
+		for (uint32_t v = 0; v < 4096; v += 7)
+		{
+			uint32_t c = u | (v << 16);
+			check("q15x2_from_adc12", dsp_q15x2_from_adc12(c, CONF_I_ADC_MID_COUNTS),
+					ref_q15x2_from_adc12(c, CONF_I_ADC_MID_COUNTS), c, 0);
+		}
+	}
+}
+
+static void test_vec(void)
+{
+	static q16_t a[VEC_MAX_N], b[VEC_MAX_N];
+	static q16_t out_dsp[VEC_MAX_N], out_ref[VEC_MAX_N];
+
+	/* n = 0..VEC_MAX_N で 4 要素展開の端数処理をすべて通す */
+	for (uint32_t rep = 0; rep < 2000; rep++)
+	{
+		for (size_t n = 0; n <= VEC_MAX_N; n++)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				a[i] = (rnd() & 7u) ? rnd_q16() : k_edge_q16[rnd() % N_EDGE_Q16];
+				b[i] = (rnd() & 7u) ? rnd_q16() : k_edge_q16[rnd() % N_EDGE_Q16];
+			}
+			q16_t k = (rnd() & 3u) ? rnd_q16() : k_edge_q16[rnd() % N_EDGE_Q16];
+
+			dsp_vec_q16_mul_sat(out_dsp, a, b, n);
+			ref_vec_q16_mul_sat(out_ref, a, b, n);
+			for (size_t i = 0; i < n; i++)
+				check("vec_q16_mul_sat", out_dsp[i], out_ref[i], a[i], b[i]);
+
+			dsp_vec_q16_scale_add(out_dsp, a, k, b, n);
+			ref_vec_q16_scale_add(out_ref, a, k, b, n);
+			for (size_t i = 0; i < n; i++)
+				check("vec_q16_scale_add", out_dsp[i], out_ref[i], a[i], b[i]);
+
+			/* 内積は累積器が飽和しない範囲（|a|,|b| < 2^26）で比べる */
+			for (size_t i = 0; i < n; i++)
+			{
+				a[i] >>= 5;
+				b[i] >>= 5;
+			}
+			check("vec_q16_dot", dsp_vec_q16_dot(a, b, n), ref_vec_q16_dot(a, b, n),
+					(int64_t) n, 0);
+
+			vec_q16_stats_t sd = dsp_vec_q16_stats(a, n);
+			vec_q16_stats_t sr = ref_vec_q16_stats(a, n);
+			check("vec_q16_stats", sd.min, sr.min, (int64_t) n, 0);
+			check("vec_q16_stats", sd.max, sr.max, (int64_t) n, 1);
+			check("vec_q16_stats", sd.mean, sr.mean, (int64_t) n, 2);
+		}
+	}
+}
+
+int main(void)
+{
+	if (dsp_backend() != 1 || ref_backend() != 0)
+	{
+		printf("FAIL: backend selection dsp=%d ref=%d\n", dsp_backend(),
+				ref_backend());
+		return 1;
+	}
+
+	test_q16();
+	test_q15x2();
+	test_vec();
+
+	printf("test_q16_dsp: %lu checks, %lu mismatches\n",
+			(unsigned long) s_checked, (unsigned long) s_failed);
+	return (s_failed == 0) ? 0 : 1;
+}
@@ -32,10 +32,9 @@ static inline void adc_vcal_update(adc_vcal_t *s, int32_t adc_raw_pa0)
 {
 	if (adc_raw_pa0 <= 0)
 		return;
-	q16_t den = q16_from_int(adc_raw_pa0);
-	q16_t q4095 = q16_from_int(4095);
-	q16_t vdda_est = q16_div(q16_mul(s->v_ref_in, q4095), den);
-	q16_t vlsb_est = q16_div(vdda_est, q4095);
+	/* V/LSB = v_ref/adc。adc/4096 の逆数を使い除算を避ける */
+	q16_t inv = q16_recip(adc_raw_pa0 << (Q16_FBITS - 12));
+	q16_t vlsb_est = (q16_mul(s->v_ref_in, inv) + (1 << 11)) >> 12;
 	q16_t one_minus = q16_sub_sat(Q16_ONE, s->alpha);
 	q16_t tmp = q16_mul(one_minus, s->v_per_lsb);
 	q16_t tmp2 = q16_mul(s->alpha, vlsb_est);
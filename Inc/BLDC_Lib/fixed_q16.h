@@ -3,6 +3,9 @@
  *   Q16.16 固定小数点（小数16bit）による整数演算ユーティリティ。
  * 注意：
  *   すべて整数演算。64bit 中間値で飽和処理を行う。
+ *   CONF_Q16_USE_DSP=1 かつ DSP 拡張を持つコア（Cortex-M4）では
+ *   q16_mul / q16_add_sat / q16_sub_sat を SMULL+SSAT / QADD / QSUB に置換する。
+ *   *_ref は移植用 C 実装で、両者はビット単位で同一の結果を返す（Host/test_q16_dsp で総当たり＋乱数検査）。
  */
 #ifndef FIXED_Q16_H
 #define FIXED_Q16_H
@@ -10,6 +13,12 @@
 #include "config.h"
 #include <stdint.h>
 
+#if (CONF_Q16_USE_DSP) && defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define Q16_BACKEND_DSP		1
+#include "cmsis_compiler.h"
+#else
+#define Q16_BACKEND_DSP		0
+#endif
 
 typedef int32_t q16_t;
 
@@ -36,7 +45,7 @@ static inline q16_t q16_to_int_rnd(q16_t x)
 	}
 }
 
-static inline q16_t q16_mul(q16_t a, q16_t b)
+static inline q16_t q16_mul_ref(q16_t a, q16_t b)
 {
 	int64_t t = (int64_t) a * (int64_t) b;
 	t = (t + (int64_t) Q16_HALF) >> Q16_FBITS;
@@ -47,15 +56,32 @@ static inline q16_t q16_mul(q16_t a, q16_t b)
 	return (q16_t) t;
 }
 
+static inline q16_t q16_mul(q16_t a, q16_t b)
+{
+#if Q16_BACKEND_DSP
+	/* SMLAL で丸め込み積 → 上位語を 16bit 飽和判定（SSAT）→ 中央 32bit を取り出す */
+	int64_t t = (int64_t) a * (int64_t) b + (int64_t) Q16_HALF;
+	int32_t hi = (int32_t) (t >> 32);
+	uint32_t lo = (uint32_t) t;
+	if (__SSAT(hi, 16) != hi)
+		return (hi < 0) ? Q16_MIN : Q16_MAX;
+	return (q16_t) (((uint32_t) hi << 16) | (lo >> Q16_FBITS));
+#else
+	return q16_mul_ref(a, b);
+#endif
+}
+
 static inline q16_t q16_div(q16_t a, q16_t b)
 {
 	if (b == 0)
 		return (a >= 0) ? Q16_MAX : Q16_MIN;
 	int64_t t = ((int64_t) a << Q16_FBITS);
-	if ((t >= 0 && b > 0) || (t < 0 && b < 0))
-		t += (b > 0) ? (b / 2) : (-b / 2);
+	/* 除算は 0 方向への切り捨てなので、被除数の符号側へ |b|/2 ずらして四捨五入にする */
+	int64_t half = (b > 0) ? (b / 2) : -((int64_t) b / 2);
+	if (t >= 0)
+		t += half;
 	else
-		t -= (b > 0) ? (b / 2) : (-b / 2);
+		t -= half;
 	int64_t q = t / b;
 	if (q > (int64_t) Q16_MAX)
 		return Q16_MAX;
@@ -64,7 +90,49 @@ static inline q16_t q16_div(q16_t a, q16_t b)
 	return (q16_t) q;
 }
 
-static inline q16_t q16_add_sat(q16_t a, q16_t b)
+/* 1/x（入力 Q(fin), 出力 Q(fout)）。CLZ で正規化し Newton-Raphson 3回で収束させる（除算命令不使用） */
+static inline int32_t fixed_recip(int32_t x, int fin, int fout)
+{
+	if (x == 0)
+		return Q16_MAX;
+	uint32_t ux = (x < 0) ? (uint32_t) (-(int64_t) x) : (uint32_t) x;
+	int n = __builtin_clz(ux);
+	uint32_t m = ux << n; /* m/2^32 ∈ [0.5, 1) */
+
+	/* 初期値 r0 = 48/17 - 32/17·m（Q30）, r ← r·(2 - m·r) */
+	uint32_t r = 0xB4B4B4B4u - (uint32_t) (((uint64_t) m * 0x78787878u) >> 32);
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t e = (uint32_t) (((uint64_t) m * r) >> 32); /* m·r（Q30） */
+		r = (uint32_t) (((uint64_t) r * (0x80000000u - e)) >> 30);
+	}
+
+	/* 1/x = r·2^(fin+fout+n-62)（Q16→Q16 では r >> (30-n)） */
+	int sh = 62 - fin - fout - n;
+	int32_t y;
+	if (sh <= 0)
+	{
+		if (sh <= -31 || r > (0x7FFFFFFFu >> -sh))
+			return (x < 0) ? Q16_MIN : Q16_MAX;
+		y = (int32_t) (r << -sh);
+	}
+	else if (sh >= 32)
+	{
+		y = 0;
+	}
+	else
+	{
+		y = (int32_t) ((r + ((1u << sh) >> 1)) >> sh);
+	}
+	return (x < 0) ? -y : y;
+}
+
+static inline q16_t q16_recip(q16_t x)
+{
+	return fixed_recip(x, Q16_FBITS, Q16_FBITS);
+}
+
+static inline q16_t q16_add_sat_ref(q16_t a, q16_t b)
 {
 	int64_t s = (int64_t) a + (int64_t) b;
 	if (s > (int64_t) Q16_MAX)
@@ -74,7 +142,7 @@ static inline q16_t q16_add_sat(q16_t a, q16_t b)
 	return (q16_t) s;
 }
 
-static inline q16_t q16_sub_sat(q16_t a, q16_t b)
+static inline q16_t q16_sub_sat_ref(q16_t a, q16_t b)
 {
 	int64_t d = (int64_t) a - (int64_t) b;
 	if (d > (int64_t) Q16_MAX)
@@ -84,6 +152,72 @@ static inline q16_t q16_sub_sat(q16_t a, q16_t b)
 	return (q16_t) d;
 }
 
+static inline q16_t q16_add_sat(q16_t a, q16_t b)
+{
+#if Q16_BACKEND_DSP
+	return __QADD(a, b);
+#else
+	return q16_add_sat_ref(a, b);
+#endif
+}
+
+static inline q16_t q16_sub_sat(q16_t a, q16_t b)
+{
+#if Q16_BACKEND_DSP
+	return __QSUB(a, b);
+#else
+	return q16_sub_sat_ref(a, b);
+#endif
+}
+
+/* √x（x ≤ 0 は 0）。桁ごとの開平法、1.0 未満は 32bit だけで済ませる */
+static inline q16_t q16_sqrt(q16_t x)
+{
+	if (x <= 0)
+		return 0;
+	if (x < Q16_ONE)
+	{
+		uint32_t v = (uint32_t) x << Q16_FBITS;
+		uint32_t r = 0;
+		uint32_t bit = 1u << 30;
+		while (bit > v)
+			bit >>= 2;
+		while (bit)
+		{
+			if (v >= r + bit)
+			{
+				v -= r + bit;
+				r = (r >> 1) + bit;
+			}
+			else
+			{
+				r >>= 1;
+			}
+			bit >>= 2;
+		}
+		return (q16_t) r;
+	}
+	uint64_t v = (uint64_t) x << Q16_FBITS;
+	uint64_t r = 0;
+	uint64_t bit = (uint64_t) 1 << 46;
+	while (bit > v)
+		bit >>= 2;
+	while (bit)
+	{
+		if (v >= r + bit)
+		{
+			v -= r + bit;
+			r = (r >> 1) + bit;
+		}
+		else
+		{
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (q16_t) r;
+}
+
 static inline q16_t angle_wrap_q16(q16_t th)
 {
 	if (th > Q16_ONE)
@@ -0,0 +1,80 @@
+/* fixed_qn.h
+ * 目的：
+ *   Q16.16 以外の Q 形式を型名で明示する固定小数点レイヤ（マクロ生成）。
+ *   手書きの >>15 / <<31 を「どの形式からどの形式へ」の変換として書けるようにする。
+ * 注意：
+ *   形式（小数ビット数）はすべてコンパイル時定数。インライン展開後は分岐が消え、
+ *   生の q16_t 演算と同じ命令列になる。
+ */
+#ifndef FIXED_QN_H
+#define FIXED_QN_H
+
+#include <stdint.h>
+#include "fixed_q16.h"
+
+
+static inline int32_t qn_sat64(int64_t t)
+{
+	if (t > (int64_t) INT32_MAX)
+		return INT32_MAX;
+	if (t < (int64_t) INT32_MIN)
+		return INT32_MIN;
+	return (int32_t) t;
+}
+
+/* Q(from) → Q(to)：縮小は丸め付き右シフト、拡大は飽和付き左シフト */
+static inline int32_t qn_convert(int32_t x, int from, int to)
+{
+	if (to < from)
+	{
+		int sh = from - to;
+		return (int32_t) (((int64_t) x + ((int64_t) 1 << (sh - 1))) >> sh);
+	}
+	if (to > from)
+		return qn_sat64((int64_t) x << (to - from));
+	return x;
+}
+
+/* a(Q fa) × b(Q fb) → Q fo（丸め・飽和） */
+static inline int32_t qn_mul(int32_t a, int fa, int32_t b, int fb, int fo)
+{
+	int64_t t = (int64_t) a * (int64_t) b;
+	int sh = fa + fb - fo;
+	if (sh > 0)
+		t = (t + ((int64_t) 1 << (sh - 1))) >> sh;
+	else if (sh < 0)
+		t <<= -sh;
+	return qn_sat64(t);
+}
+
+
+/* NAME_t と q16_t との変換・乗算・逆数を生成する */
+#define FIXED_QN_DEFINE(NAME, FBITS) \
+typedef int32_t NAME##_t; \
+static inline NAME##_t NAME##_from_q16(q16_t x) \
+{ \
+	return qn_convert(x, Q16_FBITS, (FBITS)); \
+} \
+static inline q16_t NAME##_to_q16(NAME##_t x) \
+{ \
+	return qn_convert(x, (FBITS), Q16_FBITS); \
+} \
+static inline NAME##_t NAME##_mul(NAME##_t a, NAME##_t b) \
+{ \
+	return qn_mul(a, (FBITS), b, (FBITS), (FBITS)); \
+} \
+static inline q16_t NAME##_mul_q16(NAME##_t a, q16_t b) \
+{ \
+	return qn_mul(a, (FBITS), b, Q16_FBITS, Q16_FBITS); \
+} \
+static inline q16_t NAME##_recip_q16(NAME##_t x) \
+{ \
+	return fixed_recip(x, (FBITS), Q16_FBITS); \
+}
+
+
+FIXED_QN_DEFINE(q31, 31)		/* Q1.31：制御周期など 1 未満の小さな量 */
+FIXED_QN_DEFINE(q30, 30)		/* Q2.30：重み・係数など ±2 未満の量 */
+
+
+#endif
@@ -18,6 +18,8 @@ typedef struct
 	q16_t out_max;
 	q16_t integrator;
 	q16_t prev_meas;
+	q16_t dt;			/* dt_inv を計算した時の dt */
+	q16_t dt_inv;		/* 1/dt（dt 変更時のみ再計算） */
 } pid_q16_t;
 
 
@@ -25,6 +27,8 @@ static inline void pid_q16_init(pid_q16_t *p)
 {
 	p->integrator = 0;
 	p->prev_meas = 0;
+	p->dt = 0;
+	p->dt_inv = 0;
 }
 
 static inline q16_t pid_q16_step(pid_q16_t *p, q16_t setpoint,
@@ -35,9 +39,14 @@ static inline q16_t pid_q16_step(pid_q16_t *p, q16_t setpoint,
 	/* D は測定値微分（ノイズ増幅を抑える） */
 	q16_t d_meas = q16_sub_sat(measurement, p->prev_meas);
 	q16_t D = 0;
+	if (dt != p->dt)
+	{
+		p->dt = dt;
+		p->dt_inv = q16_recip(dt);
+	}
 	if (dt != 0)
 	{
-		D = q16_div(d_meas, dt);
+		D = q16_mul(d_meas, p->dt_inv);
 		D = q16_mul(p->kd, D);
 		D = -D;
 	}
@@ -0,0 +1,166 @@
+/* q15x2.h
+ * 目的：
+ *   Q1.15 を 2 要素まとめた 32bit パック型と、Clarke / Park / 逆Park カーネル。
+ *   Cortex-M4 では SMUAD / SMUSD / QADD16 等の SIMD 命令で2要素を同時に処理する。
+ * 注意：
+ *   下位16bit = 第1要素（α, d, U, cos）、上位16bit = 第2要素（β, q, V, sin）。
+ *   DSP 命令が無い環境では同じ結果を返す C 実装に切り替わる。
+ */
+#ifndef Q15X2_H
+#define Q15X2_H
+
+#include <stdint.h>
+#include "fixed_q16.h"
+
+
+typedef int16_t q15_t;
+typedef uint32_t q15x2_t;
+
+#define Q15_MAX		((q15_t)0x7FFF)
+#define Q15_MIN		((q15_t)0x8000)
+
+/* Clarke 係数（1/(2√3), 1/√3）: 積和後に >>14 で β = (a + 2b)/√3 */
+#define Q15_INV_2SQRT3		((q15_t)9459)
+#define Q15_INV_SQRT3		((q15_t)18919)
+
+
+static inline q15_t q15_sat(int32_t x)
+{
+#if Q16_BACKEND_DSP
+	return (q15_t) __SSAT(x, 16);
+#else
+	if (x > Q15_MAX)
+		return Q15_MAX;
+	if (x < Q15_MIN)
+		return Q15_MIN;
+	return (q15_t) x;
+#endif
+}
+
+static inline q15_t q15_from_q16(q16_t x)
+{
+	return q15_sat(x >> 1);
+}
+
+static inline q16_t q16_from_q15(q15_t x)
+{
+	return (q16_t) x * 2;
+}
+
+static inline q15x2_t q15x2_pack(q15_t lo, q15_t hi)
+{
+#if Q16_BACKEND_DSP
+	return __PKHBT((uint32_t) lo, (uint32_t) hi, 16);
+#else
+	return (uint32_t) (uint16_t) lo | ((uint32_t) (uint16_t) hi << 16);
+#endif
+}
+
+static inline q15_t q15x2_lo(q15x2_t x)
+{
+	return (q15_t) (x & 0xFFFF);
+}
+
+static inline q15_t q15x2_hi(q15x2_t x)
+{
+	return (q15_t) (x >> 16);
+}
+
+static inline q15x2_t q15x2_qadd(q15x2_t a, q15x2_t b)
+{
+#if Q16_BACKEND_DSP
+	return __QADD16(a, b);
+#else
+	return q15x2_pack(q15_sat((int32_t) q15x2_lo(a) + q15x2_lo(b)),
+			q15_sat((int32_t) q15x2_hi(a) + q15x2_hi(b)));
+#endif
+}
+
+static inline q15x2_t q15x2_qsub(q15x2_t a, q15x2_t b)
+{
+#if Q16_BACKEND_DSP
+	return __QSUB16(a, b);
+#else
+	return q15x2_pack(q15_sat((int32_t) q15x2_lo(a) - q15x2_lo(b)),
+			q15_sat((int32_t) q15x2_hi(a) - q15x2_hi(b)));
+#endif
+}
+
+/* a.lo*b.lo + a.hi*b.hi（Q30） */
+static inline int32_t q15x2_smuad(q15x2_t a, q15x2_t b)
+{
+#if Q16_BACKEND_DSP
+	return (int32_t) __SMUAD(a, b);
+#else
+	return (int32_t) ((uint32_t) ((int32_t) q15x2_lo(a) * q15x2_lo(b))
+			+ (uint32_t) ((int32_t) q15x2_hi(a) * q15x2_hi(b)));
+#endif
+}
+
+/* a.lo*b.hi + a.hi*b.lo（Q30） */
+static inline int32_t q15x2_smuadx(q15x2_t a, q15x2_t b)
+{
+#if Q16_BACKEND_DSP
+	return (int32_t) __SMUADX(a, b);
+#else
+	return (int32_t) ((uint32_t) ((int32_t) q15x2_lo(a) * q15x2_hi(b))
+			+ (uint32_t) ((int32_t) q15x2_hi(a) * q15x2_lo(b)));
+#endif
+}
+
+/* a.lo*b.lo - a.hi*b.hi（Q30） */
+static inline int32_t q15x2_smusd(q15x2_t a, q15x2_t b)
+{
+#if Q16_BACKEND_DSP
+	return (int32_t) __SMUSD(a, b);
+#else
+	return (int32_t) ((uint32_t) ((int32_t) q15x2_lo(a) * q15x2_lo(b))
+			- (uint32_t) ((int32_t) q15x2_hi(a) * q15x2_hi(b)));
+#endif
+}
+
+/* a.lo*b.hi - a.hi*b.lo（Q30） */
+static inline int32_t q15x2_smusdx(q15x2_t a, q15x2_t b)
+{
+#if Q16_BACKEND_DSP
+	return (int32_t) __SMUSDX(a, b);
+#else
+	return (int32_t) ((uint32_t) ((int32_t) q15x2_lo(a) * q15x2_hi(b))
+			- (uint32_t) ((int32_t) q15x2_hi(a) * q15x2_lo(b)));
+#endif
+}
+
+/* 12bit ADC カウント2本（パック済み）→ 中点を引いて Q1.15 の両極性値へ */
+static inline q15x2_t q15x2_from_adc12(uint32_t counts, uint16_t mid)
+{
+	q15x2_t mid2 = (uint32_t) mid | ((uint32_t) mid << 16);
+	q15x2_t d = q15x2_qsub(counts, mid2);
+	/* 各レーン ±2048 → ±32768（下位レーンの符号拡張ビットはマスクで落とす） */
+	return (d << 4) & 0xFFF0FFF0u;
+}
+
+/* Clarke: (a, b) → (α, β) = (a, (a + 2b)/√3) */
+static inline q15x2_t clarke_q15x2(q15x2_t ab)
+{
+	q15x2_t k = q15x2_pack(Q15_INV_2SQRT3, Q15_INV_SQRT3);
+	q15_t beta = q15_sat(q15x2_smuad(ab, k) >> 14);
+	return q15x2_pack(q15x2_lo(ab), beta);
+}
+
+/* Park: (α, β), (cos, sin) → (d, q) */
+static inline q15x2_t park_q15x2(q15x2_t alphabeta, q15x2_t cs)
+{
+	q15_t d = q15_sat(q15x2_smuad(alphabeta, cs) >> 15);
+	q15_t q = q15_sat(q15x2_smusdx(cs, alphabeta) >> 15);
+	return q15x2_pack(d, q);
+}
+
+/* 逆Park: (d, q), (cos, sin) → (α, β) */
+static inline q15x2_t inv_park_q15x2(q15x2_t dq, q15x2_t cs)
+{
+	q15_t alpha = q15_sat(q15x2_smusd(cs, dq) >> 15);
+	q15_t beta = q15_sat(q15x2_smuadx(cs, dq) >> 15);
+	return q15x2_pack(alpha, beta);
+}
+
+#endif
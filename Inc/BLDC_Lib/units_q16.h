@@ -17,6 +17,7 @@ extern adc_vcal_t g_vcal; /* app.c で定義 */
 static const q16_t UQ_RSHUNT_OHM = (q16_t)CONFIG_RSHUNT_OHM_Q16;
 static const q16_t UQ_AMP_GAIN   = (q16_t)CONFIG_AMP_GAIN_Q16;
 static const q16_t UQ_VOFFSET_V  = (q16_t)CONFIG_VOFFSET_V_Q16;
+static const q16_t UQ_CURR_PER_VOLT = (q16_t)CONFIG_CURR_PER_VOLT_Q16;
 
 /* ADC 生→電圧[V]（較正 V/LSB 使用）*/
 static inline q16_t uq_adc_to_volt(int32_t adc)
@@ -29,8 +30,7 @@ static inline q16_t uq_adc_to_volt(int32_t adc)
 static inline q16_t uq_volt_to_curr(q16_t v)
 {
 	q16_t num = q16_sub_sat(v, UQ_VOFFSET_V);
-	q16_t den = q16_mul(UQ_RSHUNT_OHM, UQ_AMP_GAIN);
-	return q16_div(num, den);
+	return q16_mul(num, UQ_CURR_PER_VOLT);
 }
 
 
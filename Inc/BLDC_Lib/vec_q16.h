@@ -0,0 +1,167 @@
+/* vec_q16.h
+ * 目的：
+ *   Q16.16 配列に対する一括演算（同定・テレメトリ後処理・リプル解析などオフライン処理用）。
+ *   要素ごとの飽和乗算、スケール付き加算、内積（64bit 累積）、最小/最大/平均。
+ * 注意：
+ *   Q16_BACKEND_DSP では 4 要素展開したスカラ経路。専用の組み込み関数は使わず、要素ごとの演算は
+ *   fixed_q16.h の DSP 版 q16_mul（SMLAL＋SSAT）/ q16_add_sat（QADD）に任せる。
+ *   Q16.16 は 32bit 幅なので q15x2.h の 16bit×2 SIMD には載らない。
+ *   それ以外では分岐の無い素直なループ（ホストのコンパイラが自動ベクトル化できる形）。
+ *   両者は fixed_q16.h の *_ref と同じくビット単位で同一の結果を返す。
+ *   dst は入力と同じ配列でもよい（要素ごとに読んでから書く）。
+ */
+#ifndef VEC_Q16_H
+#define VEC_Q16_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fixed_q16.h"
+
+
+/* 64bit → q16 飽和（分岐無し、ベクトル化用） */
+static inline q16_t vec_q16_sat64(int64_t t)
+{
+	t = (t > (int64_t) Q16_MAX) ? (int64_t) Q16_MAX : t;
+	t = (t < (int64_t) Q16_MIN) ? (int64_t) Q16_MIN : t;
+	return (q16_t) t;
+}
+
+
+/* dst[i] = a[i] × b[i]（丸め・飽和） */
+static inline void vec_q16_mul_sat(q16_t *dst, const q16_t *a, const q16_t *b,
+		size_t n)
+{
+	size_t i = 0;
+#if Q16_BACKEND_DSP
+	for (; i + 4 <= n; i += 4)
+	{
+		q16_t a0 = a[i], a1 = a[i + 1], a2 = a[i + 2], a3 = a[i + 3];
+		q16_t b0 = b[i], b1 = b[i + 1], b2 = b[i + 2], b3 = b[i + 3];
+		dst[i] = q16_mul(a0, b0);
+		dst[i + 1] = q16_mul(a1, b1);
+		dst[i + 2] = q16_mul(a2, b2);
+		dst[i + 3] = q16_mul(a3, b3);
+	}
+	for (; i < n; i++)
+		dst[i] = q16_mul(a[i], b[i]);
+#else
+	for (; i < n; i++)
+		dst[i] = vec_q16_sat64(((int64_t) a[i] * b[i] + Q16_HALF) >> Q16_FBITS);
+#endif
+}
+
+/* dst[i] = a[i] + k × b[i]（積は丸め・飽和、和も飽和） */
+static inline void vec_q16_scale_add(q16_t *dst, const q16_t *a, q16_t k,
+		const q16_t *b, size_t n)
+{
+	size_t i = 0;
+#if Q16_BACKEND_DSP
+	for (; i + 4 <= n; i += 4)
+	{
+		q16_t a0 = a[i], a1 = a[i + 1], a2 = a[i + 2], a3 = a[i + 3];
+		q16_t b0 = b[i], b1 = b[i + 1], b2 = b[i + 2], b3 = b[i + 3];
+		dst[i] = q16_add_sat(a0, q16_mul(k, b0));
+		dst[i + 1] = q16_add_sat(a1, q16_mul(k, b1));
+		dst[i + 2] = q16_add_sat(a2, q16_mul(k, b2));
+		dst[i + 3] = q16_add_sat(a3, q16_mul(k, b3));
+	}
+	for (; i < n; i++)
+		dst[i] = q16_add_sat(a[i], q16_mul(k, b[i]));
+#else
+	for (; i < n; i++)
+	{
+		q16_t kb = vec_q16_sat64(((int64_t) k * b[i] + Q16_HALF) >> Q16_FBITS);
+		dst[i] = vec_q16_sat64((int64_t) a[i] + kb);
+	}
+#endif
+}
+
+/* Σ a[i]·b[i] を Q32.32 のまま返す（途中の丸め無し）
+ * 注意：n·max|a|·max|b| < 2^63 の範囲で使うこと（累積器は飽和しない） */
+static inline int64_t vec_q16_dot_q32(const q16_t *a, const q16_t *b, size_t n)
+{
+	int64_t acc = 0;
+	size_t i = 0;
+#if Q16_BACKEND_DSP
+	/* 積和はコンパイラが SMLAL にする。2本の累積器で依存の連鎖を切る */
+	int64_t acc1 = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		acc += (int64_t) a[i] * b[i];
+		acc1 += (int64_t) a[i + 1] * b[i + 1];
+		acc += (int64_t) a[i + 2] * b[i + 2];
+		acc1 += (int64_t) a[i + 3] * b[i + 3];
+	}
+	acc += acc1;
+#endif
+	for (; i < n; i++)
+		acc += (int64_t) a[i] * b[i];
+	return acc;
+}
+
+/* Σ a[i]·b[i]（最後に1回だけ丸めて q16 へ飽和） */
+static inline q16_t vec_q16_dot(const q16_t *a, const q16_t *b, size_t n)
+{
+	int64_t acc = vec_q16_dot_q32(a, b, n);
+	if (acc > INT64_MAX - Q16_HALF)
+		return Q16_MAX;
+	return vec_q16_sat64((acc + Q16_HALF) >> Q16_FBITS);
+}
+
+
+typedef struct
+{
+	q16_t min;
+	q16_t max;
+	q16_t mean;			/* 丸め付き（64bit 和 / n） */
+} vec_q16_stats_t;
+
+/* 最小・最大・平均（n = 0 のときはすべて 0） */
+static inline vec_q16_stats_t vec_q16_stats(const q16_t *a, size_t n)
+{
+	vec_q16_stats_t st = { 0, 0, 0 };
+	if (n == 0)
+		return st;
+
+	q16_t mn = a[0], mx = a[0];
+	int64_t sum = 0;
+	size_t i = 0;
+#if Q16_BACKEND_DSP
+	q16_t mn1 = a[0], mx1 = a[0];
+	int64_t sum1 = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		q16_t x0 = a[i], x1 = a[i + 1], x2 = a[i + 2], x3 = a[i + 3];
+		mn = (x0 < mn) ? x0 : mn;
+		mx = (x0 > mx) ? x0 : mx;
+		mn1 = (x1 < mn1) ? x1 : mn1;
+		mx1 = (x1 > mx1) ? x1 : mx1;
+		mn = (x2 < mn) ? x2 : mn;
+		mx = (x2 > mx) ? x2 : mx;
+		mn1 = (x3 < mn1) ? x3 : mn1;
+		mx1 = (x3 > mx1) ? x3 : mx1;
+		sum += (int64_t) x0 + x2;
+		sum1 += (int64_t) x1 + x3;
+	}
+	mn = (mn1 < mn) ? mn1 : mn;
+	mx = (mx1 > mx) ? mx1 : mx;
+	sum += sum1;
+#endif
+	for (; i < n; i++)
+	{
+		q16_t x = a[i];
+		mn = (x < mn) ? x : mn;
+		mx = (x > mx) ? x : mx;
+		sum += x;
+	}
+
+	int64_t half = (int64_t) (n / 2);
+	st.min = mn;
+	st.max = mx;
+	st.mean = (q16_t) ((sum >= 0) ? ((sum + half) / (int64_t) n)
+			: ((sum - half) / (int64_t) n));
+	return st;
+}
+
+
+#endif
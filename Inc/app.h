@@ -10,8 +10,8 @@
 
 #include "fixed_q16.h"
 
-void sincos_q16(q16_t th, q16_t *s, q16_t *c);
 void APP_Init(void);
 void APP_Step(void);
+void APP_Background(void);
 
 #endif
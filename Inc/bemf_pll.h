@@ -10,24 +10,25 @@
 
 
 #include "fixed_q16.h"
+#include "fixed_qn.h"
+#include "trig.h"
 
 
 typedef struct
 {
-	q16_t theta_q16;
-	q16_t omega_q16;
+	turn32_t theta_t32;		/* 推定電気角（2^32 = 1 turn） */
+	int32_t omega_t32;		/* 1周期あたりの Δθ（2^32 = 1 turn） */
+	q16_t omega_q16;		/* omega_t32 の turn-Q16 表現（速度制御・判定用） */
 	q16_t kp_q16;
 	q16_t ki_q16;
 	q16_t kd_q16;
-	q16_t integ_q16;
+	int32_t integ_t32;
 	q16_t Rs_q16;
-	q16_t Ls_q16;
-	q16_t Ts_q16;
-	q16_t Ts_inv_q16;
+	q16_t Ls_fs_q16;		/* Ls/Ts [Ω]（1/Ts は Q16 に収まらないので Ls 側に畳み込む。FOC_t の ld_fs_q16 と同じ） */
 	q16_t alpha_q16;
 	q16_t i_alpha_prev;
 	q16_t i_beta_prev;
-	q16_t di_alpha_q16;
+	q16_t di_alpha_q16;		/* 平滑化した 1 周期あたりの電流増分 */
 	q16_t di_beta_q16;
 	q16_t e_alpha_q16;
 	q16_t e_beta_q16;
@@ -38,8 +39,8 @@ typedef struct
 } BEMF_PLL_t;
 
 void BEMF_PLL_Init(BEMF_PLL_t *o);
-void BEMF_PLL_Step(BEMF_PLL_t *o, q16_t v_alpha_q16, q16_t v_beta_q16,
-		q16_t i_alpha_q16, q16_t i_beta_q16);
+void BEMF_PLL_Step(BEMF_PLL_t *o, const RotorFrame_t *f, q16_t v_alpha_q16,
+		q16_t v_beta_q16, q16_t i_alpha_q16, q16_t i_beta_q16);
 
 
 #endif
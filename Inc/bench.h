@@ -0,0 +1,49 @@
+/* bench.h
+ * 目的：
+ *   BLDC_Lib の演算プリミティブ（fixed_q16 / pid / slew / softstart / trig）の
+ *   実行時間と精度を計測する。
+ * 注意：
+ *   実機では CONF_BENCH_ENABLE=1 のときだけ main() から呼ばれ、結果は g_bench をデバッガでダンプする。
+ *   ホストでは Host/ のビルドが同じケースを回して CSV に書き出す（Host/Makefile 参照）。
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+
+#define BENCH_MAGIC			0x48434E42u		/* "BNCH" */
+#define BENCH_VERSION		4u
+#define BENCH_MAX_RESULTS	32
+
+
+typedef struct
+{
+	char name[16];
+	uint32_t n_ops;				/* 計測した呼び出し回数 */
+	float ticks_per_op;			/* ループオーバーヘッド差し引き後（実機：コアクロック, ホスト：ns） */
+	float ns_per_op;
+	float sat_rate;				/* 飽和（出力が表現範囲外）になった割合 */
+	float max_err_lsb;			/* double 参照値との差（出力 LSB 単位） */
+	float rms_err_lsb;
+	float max_err_limit_lsb;	/* これを超えたら fail_mask に立てる */
+} BenchResult_t;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t tick_hz;			/* 時間源の周波数（実機：SystemCoreClock, ホスト：1e9） */
+	uint32_t count;
+	uint32_t fail_mask;			/* bit i = results[i] が精度上限を超えた */
+	uint32_t done;
+	BenchResult_t results[BENCH_MAX_RESULTS];
+} BenchReport_t;
+
+
+extern BenchReport_t g_bench;
+
+void BENCH_Run(void);
+
+
+#endif
@@ -21,6 +21,25 @@
 #define PWM_FREQ_HZ		21000
 #define TIM1_ARR		(TIM1_CLK_HZ/(2*PWM_FREQ_HZ) - 1)
 
+/* ダブルアップデート（1: 山と谷の両方で CCR 更新を行い、制御周期を PWM の 2 倍にする。
+ * スイッチング回数は不変。CONF_CTRL_SYNC_ISR=1 と 3シャントが前提）
+ * 注意：下側シャントは谷で全相 OFF なので、実測の電流帰還は山の 21 kHz のまま。
+ * 谷の周期は FOC_PredictCounts のモデル予測電流で回す（電圧指令の更新だけが 42 kHz。
+ * 予測誤差は Rs/Ld/Lq のずれに比例し、次の山の実測で毎回打ち消される） */
+#define CONF_PWM_DOUBLE_UPDATE	0
+#define CTRL_UPDATES_PER_PWM	(1 + CONF_PWM_DOUBLE_UPDATE)
+#define CTRL_FREQ_HZ			(PWM_FREQ_HZ * CTRL_UPDATES_PER_PWM)		/* 制御周期（APP_Step）の周波数 */
+
+/* TIM2 は APB1 x2 = 84MHz */
+#define TIM2_CLK_HZ		(2*APB1_HZ)
+
+/* 制御周期の同期
+ *   1: 電流 ADC の完了割り込みから APP_Step を PWM 周期ごとに実行（標本→CCR 反映が 1 周期で一定）。
+ *      TIM2 は BG_FREQ_HZ のバックグラウンド処理（APP_Background）用
+ *   0: TIM2 のフラグをメインループでポーリングして APP_Step を実行（PWM とは非同期） */
+#define CONF_CTRL_SYNC_ISR	1
+#define BG_FREQ_HZ			1000
+
 /* ADC クロック (APB2/8 ≈ 10.5MHz) */
 #define ADC_CLK_HZ		21000000
 
@@ -31,6 +50,65 @@
 /* 16bit固定小数点演算用 */
 #define Q16_FBITS (16)
 #define Q16_FRAC(NUM, DEN)	((q16_t)((((int64_t)(NUM) << Q16_FBITS) + (((int64_t)DEN) / 2)) / (int64_t)(DEN)))
+#define TURN32_FRAC(NUM, DEN)	((int32_t)((((int64_t)(NUM) << 32) + (((int64_t)DEN) / 2)) / (int64_t)(DEN)))	/* 2^32 = 1 turn */
+#define QN_FRAC(NUM, DEN, FBITS)	((int32_t)((((int64_t)(NUM) << (FBITS)) + (((int64_t)DEN) / 2)) / (int64_t)(DEN)))	/* 任意Q形式 */
+
+/* 演算バックエンド選択（1: Cortex-M4 DSP命令, 0: 移植用Cリファレンス） */
+#define CONF_Q16_USE_DSP	1
+
+/* sin/cos エンジン選択（ホストビルドは -D で上書きして両方を計測する） */
+#define SINCOS_ENGINE_CORDIC	0											/* 事前計算 atan テーブルの CORDIC */
+#define SINCOS_ENGINE_LUT		1											/* 1/4波 LUT＋線形補間 */
+#ifndef CONF_SINCOS_ENGINE
+#define CONF_SINCOS_ENGINE		SINCOS_ENGINE_LUT
+#endif
+
+/* SVPWM 方式選択（FOC_t.svpwm_mode の初期値。実行中に切替可） */
+#define SVPWM_MODE_SORT			0											/* 最小値シフト＋並び替えで T0/T1/T2 */
+#define SVPWM_MODE_MINMAX		1											/* min/max 零相注入（並び替え無し） */
+#define CONF_SVPWM_MODE			SVPWM_MODE_MINMAX
+
+/* 電流制御方式（FOC_t.cur_ctrl の初期値。実行中に切替可） */
+#define CUR_CTRL_PI				0											/* PID＋非干渉化FF */
+#define CUR_CTRL_DEADBEAT		1											/* モデル予測デッドビート（演算遅れ補償付き） */
+#define CUR_CTRL_MPC			2											/* FCS-MPC：7 電圧ベクトルから 1 つを選び変調せずに出力 */
+/* CUR_CTRL_MPC は 1 周期に 1 ベクトルしか出せず、電流リプルは Vbus·Ts/L 程度になる。
+ * 12 V・21 kHz・Ld 100 µH ではリプルが数 A あり、3 A のステップで定常誤差 1.3〜1.4 A RMS・行き過ぎ 40〜50 %
+ * （sim_mpc）なので、このモータ・PWM 周波数では使えない。L が 1 桁大きいか、制御周期を大きく上げた場合の比較用 */
+#define CONF_CUR_CTRL_MODE		CUR_CTRL_PI
+#define DEADBEAT_GAIN_Q16		Q16_FRAC(1, 1)								/* 1：2 周期で到達。L 誤差が大きいときは 0.5 程度に下げる */
+
+/* 電圧ベクトル制限（Vbus 正規化の相電圧振幅）。d軸優先で円に制限する */
+#define V_LIMIT_LINEAR_Q16		Q16_FRAC(577350, 1000000)					/* 1/√3：六角形の内接円（線形変調の上限） */
+#define V_LIMIT_OVM_Q16			Q16_FRAC(636620, 1000000)					/* 2/π：6ステップの基本波 */
+#define OVM_ZONE2_START_Q16		Q16_FRAC(606, 1000)							/* 変調率 0.952 相当：ここから頂点保持 */
+#define CONF_OVERMOD_ENABLE		0											/* 1: 過変調（2ゾーン）を使い V_LIMIT_OVM まで出す */
+
+/* 電流サンプリング窓（下側シャント）：毎周期、窓の広い2相を選び CCR4 を窓内へずらす */
+#define CONF_SENSE_WINDOW_ENABLE	1
+#define SENSE_ACQ_COUNTS			336										/* 電流3ch の標本化に要る時間 [TIM1 カウント]（ADC 設定に合わせる, 約2µs） */
+#define SENSE_SMP					0										/* ADC1 の I_U/I_V/I_W サンプリング時間設定（SMPx = 0：3 cycles。3ch で 3×3+2×12 = 33 cycles） */
+
+/* 電流検出方式（基板バリアント） */
+#define SENSE_3SHUNT			0											/* 相ごとの下側シャント 3 本（ADC_CH_I_U/V/W） */
+#define SENSE_1SHUNT			1											/* DC リンクシャント 1 本：CCR を上り/下りで非対称にずらして 2 窓を作る */
+#define CONF_CURRENT_SENSE		SENSE_3SHUNT
+#define SHUNT1_ACQ_COUNTS		168											/* I_DC 1ch の標本化時間 [TIM1 カウント]（15 cycles @21MHz ≒ 0.71µs＋余裕, 1µs） */
+#define SHUNT1_SMP				1											/* ADC2 の I_DC サンプリング時間設定（SMPx = 1：15 cycles） */
+
+/* デッドタイム補償（相電流の向きで CCR を補正するフィードフォワード）。
+ * 既定は無効：この設定の電流範囲（IQ_MAX × I_MAX ≒ 2.2 A）の下半分は PWM リプル（12 V, Ld 100 µH で ±0.7 A）と
+ * 同程度で、周期内に電流が 0 を横切るため補償すると THD が悪化する（sim_dtc_thd の 0.5/1 A 行）。
+ * リプルの 2 倍を大きく超える電流で回すとき（IQ_MAX を上げた場合など）に 1 にし、sim_dtc_thd で確認する */
+#define CONF_DTC_ENABLE			0
+#define DTC_CCR_COUNTS			(DTG_TICKS / 2)								/* センターアラインでは CCR 1カウント = パルス幅 2tick */
+#define DTC_I_KNEE_Q16			Q16_FRAC(2, 100)							/* |i| がこれ未満では補償量を線形に絞る（正規化電流） */
+
+/* 演算プリミティブのベンチマーク（1: 起動時に計測して g_bench に結果を残す。制御は開始しない。
+ * ホストビルド（Host/Makefile）は -DCONF_BENCH_ENABLE=1 で上書きする） */
+#ifndef CONF_BENCH_ENABLE
+#define CONF_BENCH_ENABLE	0
+#endif
 
 
 /* ユーザー操作用定数 */
@@ -40,8 +118,8 @@
 
 #define THR_ADC_MAX_Q16        Q16_FRAC(1,1)								/* 1.0 = フルスケール */
 #define THR_DEADBAND_Q16       Q16_FRAC(1,50)								/* 0.02 ≒ 2% */
-#define THR_LPF_ALPHA_Q16      Q16_FRAC(1,8)								/* LPF係数 α (大→速応答) */
-#define THR_SLEW_PER_TICK_Q16  Q16_FRAC(1,200)								/* 1周期あたり最大変化量 */
+#define THR_LPF_ALPHA_Q16      Q16_FRAC(1,8 * CTRL_UPDATES_PER_PWM)		/* LPF係数 α (大→速応答) */
+#define THR_SLEW_PER_TICK_Q16  Q16_FRAC(1,200 * CTRL_UPDATES_PER_PWM)		/* 1周期あたり最大変化量 */
 
 
 /* 電流制限用定数 */
@@ -49,10 +127,15 @@
 #define I_MIN				(-(1000))										/* -1Aで電流制限 */
 
 
+/* 電流センスアンプ出力の 0A 点（1.65V ≒ 12bit ADC の中点） */
+#define CONF_I_ADC_MID_COUNTS	2048
+
+
 /* ADC チャネル割当 */
 #define ADC_CH_I_U			2												/* U相電流 */
 #define ADC_CH_I_V			3												/* V相電流 */
 #define ADC_CH_I_W			4												/* W相電流 */
+#define ADC_CH_I_DC			2												/* DC リンク電流（単シャント基板。I_U の端子を流用） */
 
 #define ADC_CH_V_REF		0												/* リファレンス電圧 */
 #define ADC_CH_V_BATT		1												/* バッテリー電圧(分圧) */
@@ -71,23 +154,70 @@
 
 /* EXTSEL/JEXTSEL 定数 */
 #define ADC1_EXTSEL_TIM3_TRGO			(0b1000)							/* 例：要RM/ヘッダ確認 */
-#define ADC1_JEXTSEL_TIM1_CC4			(0b0000)							/* 例：要RM/ヘッダ確認 */
+#define ADC1_JEXTSEL_TIM1_CC4			(0b0000)							/* OC4REF の立上り（PWM2：上りカウントの CNT=CCR4） */
+#define ADC1_JEXTSEL_TIM1_TRGO			(0b0001)							/* ダブルアップデート：TRGO = Update（山と谷） */
+#define ADC2_JEXTSEL_TIM1_TRGO			(0b0001)							/* TRGO = OC4REF：両エッジで CC4 の上り/下り一致 */
 
 /* シャント・アンプ・オフセット（回路図の実値に合わせて設定）*/
 #define CONFIG_RSHUNT_OHM_Q16			Q16_FRAC(5, 100)					/* 0.05 Ω */
 #define CONFIG_AMP_GAIN_Q16				Q16_FRAC(3, 1)						/* x3 */
 #define CONFIG_VOFFSET_V_Q16			Q16_FRAC(165, 100)					/* 1.65 V */
+#define CONFIG_CURR_PER_VOLT_Q16		Q16_FRAC(100, 5 * 3)				/* 1/(Rshunt×Gain) ≈ 6.67 A/V */
 #define CONF_OBS_ALPHA_Q16				Q16_FRAC(1, 5)						/* 0.2 */
 
-#define CONFIG_DT_S_Q16					Q16_FRAC(1, PWM_FREQ_HZ)			/* 1 / PWM_FREQ_HZ */
-
-/* 電流フルスケール（必要に応じて調整）*/
-#define CONFIG_I_MAX_A_Q16				Q16_FRAC(11, 1)						/* 11 A */
+#define CONFIG_DT_S_Q16					Q16_FRAC(1, CTRL_FREQ_HZ)			/* 1 / CTRL_FREQ_HZ（Q16 では 2〜3 LSB しかない。ゲインへは畳み込んで使う） */
+#define CONFIG_DT_S_Q31					QN_FRAC(1, CTRL_FREQ_HZ, 31)		/* 1 / CTRL_FREQ_HZ（Q1.31, 高分解能） */
+
+/* モータ定数（dq 非干渉化・BEMF フィードフォワード用。実機の値に合わせて設定）。
+ * 下の 4 つは仮の値（ベンチ用）。実測値に置き換えたら MOTOR_CONSTANTS_MEASURED を 1 にする。
+ * 0 の間はモデルを使う機能（非干渉化・MTPA・弱め界磁）を既定で切り、デッドビート / FCS-MPC を初期値にできない */
+#define MOTOR_CONSTANTS_MEASURED		0
+#define MOTOR_LD_UH						100									/* d軸インダクタンス [µH] */
+#define MOTOR_LQ_UH						120									/* q軸インダクタンス [µH] */
+#define MOTOR_RS_MOHM					50									/* 相巻線抵抗 [mΩ] */
+#define MOTOR_PSI_UWB					5000								/* 永久磁石鎖交磁束 [µWb] */
+#define CONFIG_VBUS_NOM_Q16				Q16_FRAC(12, 1)						/* 公称 DC バス電圧 12 V */
+#define CONFIG_VBUS_MIN_Q16				Q16_FRAC(6, 1)						/* 1/Vbus の下限クランプ（未測定・瞬断時） */
+#define CONFIG_VBUS_DIV_Q16				Q16_FRAC(11, 1)						/* バッテリー電圧分圧比 (R1+R2)/R2（回路図の実値に合わせて設定）*/
+#define CONF_VBUS_LPF_ALPHA_Q16			Q16_FRAC(1, 16 * CTRL_UPDATES_PER_PWM)	/* Vbus IIR 係数（ADC 更新ごと） */
+#define CONF_VBUS_UPDATE_TICKS			(CTRL_FREQ_HZ / 1000)				/* FOC へ Vbus と 1/Vbus を渡す間隔（約 1 kHz） */
+#define CONF_DQ_DECOUPLE_ENABLE			MOTOR_CONSTANTS_MEASURED			/* 1: -ωLq·iq / ω(Ld·id + ψ) を PID 出力に加える */
+
+/* ω[turn/周期] から ωL[Ω], ωψ[V] への係数 2π·fs·L（2π ≈ 710/113） */
+#define CONFIG_XLD_PER_TURN_Q16			Q16_FRAC(710LL * CTRL_FREQ_HZ * MOTOR_LD_UH, 113LL * 1000000)
+#define CONFIG_XLQ_PER_TURN_Q16			Q16_FRAC(710LL * CTRL_FREQ_HZ * MOTOR_LQ_UH, 113LL * 1000000)
+#define CONFIG_PSI_PER_TURN_Q16			Q16_FRAC(710LL * CTRL_FREQ_HZ * MOTOR_PSI_UWB, 113LL * 1000000)
+
+/* L/Ts [Ω] と R [Ω]（デッドビート電流制御のモデル） */
+#define CONFIG_RS_OHM_Q16				Q16_FRAC(MOTOR_RS_MOHM, 1000)
+#define CONFIG_LD_FS_Q16				Q16_FRAC(CTRL_FREQ_HZ * MOTOR_LD_UH, 1000000)
+#define CONFIG_LQ_FS_Q16				Q16_FRAC(CTRL_FREQ_HZ * MOTOR_LQ_UH, 1000000)
+
+/* MTPA（RUN 中の電流振幅指令を Ld/Lq/ψ から求めた最適な Id/Iq に分ける。Lq ≤ Ld なら Id = 0） */
+#define CONF_MTPA_ENABLE				MOTOR_CONSTANTS_MEASURED
+
+/* 弱め界磁（|v_dq| が制限円に近づいたら負の Id を積む。電流は I_MAX の円で制限） */
+#define CONF_FW_ENABLE					MOTOR_CONSTANTS_MEASURED
+#define FW_V_RATIO_Q16					Q16_FRAC(95, 100)					/* 制限円の 95% を目標に電圧を保つ */
+#define FW_KI_A_PER_VS					200									/* 積分ゲイン [A/(V·s)] */
+#define FW_KI_DT_Q16					Q16_FRAC(FW_KI_A_PER_VS, CTRL_FREQ_HZ)
+#define FW_I_LIMIT_A_Q16				Q16_FRAC(I_MAX, 1000)				/* |i_dq| の上限 [A]（I_MAX[mA]） */
+#define FW_ID_MIN_A_Q16					(-FW_I_LIMIT_A_Q16)					/* 弱め界磁 Id の下限（減磁電流に注意して絞る） */
+
+/* 電流フルスケール：正規化電流 1.0（ADC 中点から ±2048 カウント）に対応する実電流
+ * 1.65 V / (0.05 Ω × x3) = 11 A。Id_ref/Iq_ref・ADC 電流・MTPA の共通スケール（定義はここだけ） */
+#define CONFIG_I_MAX_A					11									/* 11 A */
+#define CONFIG_I_MAX_A_Q16				Q16_FRAC(CONFIG_I_MAX_A, 1)
+#define CONFIG_I_MAX_INV_Q16			Q16_FRAC(1, CONFIG_I_MAX_A)			/* 1 / I_MAX_A */
 
 /* スルーレートとソフトスタート（初期値）*/
-#define CONFIG_SLEW_UP_PER_S_Q16		Q16_FRAC(1, 1)						/* 1.0 / s */
-#define CONFIG_SLEW_DN_PER_S_Q16 		Q16_FRAC(3, 1)						/* 3.0 / s */
+#define CONFIG_SLEW_UP_V_PER_S_Q16		Q16_FRAC(12, 1)						/* 12 V/s（公称 Vbus で 1.0 / s） */
+#define CONFIG_SLEW_DN_V_PER_S_Q16 		Q16_FRAC(36, 1)						/* 36 V/s（公称 Vbus で 3.0 / s） */
 #define CONFIG_SOFTSTART_RISE_S_Q16		Q16_FRAC(3, 10)						/* 0.3 s */
+/* 同じ値の 1 制御周期あたり表現（Q16 の Ts は粗いので FOC ではこちらを使う） */
+#define CONFIG_SLEW_UP_V_PER_TICK_Q16	((CONFIG_SLEW_UP_V_PER_S_Q16 + CTRL_FREQ_HZ / 2) / CTRL_FREQ_HZ)
+#define CONFIG_SLEW_DN_V_PER_TICK_Q16	((CONFIG_SLEW_DN_V_PER_S_Q16 + CTRL_FREQ_HZ / 2) / CTRL_FREQ_HZ)
+#define CONFIG_SOFTSTART_RISE_TICKS_Q16	Q16_FRAC(3LL * CTRL_FREQ_HZ, 10)
 
 /* 角速度変換で使用（定数） */
 #define CONFIG_TWO_PI_Q16				Q16_FRAC(710,113)					/* ≈ 2π */
@@ -95,18 +225,39 @@
 
 
 /* 速度・積分制限 */
-#define CONF_OMEGA_STEP_MAX_Q16			Q16_FRAC(152, 10000)				/* 0.0152turn */
-#define CONF_OMEGA_STEP_MIN_Q16 		(-(CONF_OMEGA_STEP_MAX_Q16))		/* -0.0152turn */
-#define CONF_PLL_INT_MIN_Q16			Q16_FRAC(-1, 5)						/* -0.2 */
-#define CONF_PLL_INT_MAX_Q16			Q16_FRAC(1, 5)						/* +0.2 */
+#define CONF_OMEGA_STEP_MAX_Q16			Q16_FRAC(152, 10000 * CTRL_UPDATES_PER_PWM)	/* 0.0152turn / PWM周期 */
+#define CONF_OMEGA_STEP_MIN_Q16 		(-(CONF_OMEGA_STEP_MAX_Q16))		/* -0.0152turn / PWM周期 */
+#define CONF_PLL_INT_MIN_Q16			Q16_FRAC(-1, 5 * CTRL_UPDATES_PER_PWM * CTRL_UPDATES_PER_PWM)	/* -0.2（PWM周期換算） */
+#define CONF_PLL_INT_MAX_Q16			Q16_FRAC(1, 5 * CTRL_UPDATES_PER_PWM * CTRL_UPDATES_PER_PWM)	/* +0.2（PWM周期換算） */
 #define IQ_MAX_Q16						Q16_FRAC(2, 10)						/* 0.2 (必要に応じて調整) */
 #define IQ_MIN_Q16						Q16_FRAC(-2, 10)					/* -0.2 (必要に応じて調整) */
 
 
-/* PID制御定数 */
-#define SPEED_KP_Q16					Q16_FRAC(2, 100)					/* Pゲイン = 0.02 */
-#define SPEED_KI_Q16					Q16_FRAC(0, 2000)					/* Iゲイン = 0.00 */
-#define SPEED_KD_Q16					Q16_FRAC(0, 8000)					/* Dゲイン = 0.00 */
+/* PID制御定数（分子/分母で持ち、周期換算したゲインも Q16_FRAC で1回だけ丸める） */
+#define SPEED_KP_NUM					2									/* Pゲイン = 0.02 */
+#define SPEED_KP_DEN					100
+#define SPEED_KI_NUM					0									/* Iゲイン = 0.00 */
+#define SPEED_KI_DEN					2000
+#define SPEED_KD_NUM					0									/* Dゲイン = 0.00 */
+#define SPEED_KD_DEN					8000
+#define SPEED_KP_Q16					Q16_FRAC(SPEED_KP_NUM, SPEED_KP_DEN)
+#define SPEED_KI_Q16					Q16_FRAC(SPEED_KI_NUM, SPEED_KI_DEN)
+#define SPEED_KD_Q16					Q16_FRAC(SPEED_KD_NUM, SPEED_KD_DEN)
+
+/* 速度誤差は [turn/制御周期] なので、制御周期が K 倍速になると P は ×K で同じ [turn/s] 当たりのゲインになる
+ * （I は 1 周期の増分×周期数で打ち消し合うので不変） */
+#define SPEED_KP_TICK_Q16				Q16_FRAC(SPEED_KP_NUM * CTRL_UPDATES_PER_PWM, SPEED_KP_DEN)
+
+/* D 項は Kd·e / Ts。1/Ts（= CTRL_FREQ_HZ）は Q16 に収まらないので Kd 側に畳み込む（Kd·fs） */
+#define SPEED_KD_FS_Q16					Q16_FRAC((int64_t) SPEED_KD_NUM * CTRL_FREQ_HZ, SPEED_KD_DEN)
+#if SPEED_KD_NUM * CTRL_FREQ_HZ >= 32767 * SPEED_KD_DEN
+#error "SPEED_KD × CTRL_FREQ_HZ が Q16 の範囲を超える（Kd を下げる）"
+#endif
+
+/* BEMF PLL のループフィルタ（1 周期あたりの係数）。ω[turn/周期] を P＋I で積むので、
+ * 制御周期が K 倍速のとき同じ帯域を保つには kp/K², ki/K³ */
+#define PLL_KP_Q16						Q16_FRAC(SPEED_KP_NUM, SPEED_KP_DEN * CTRL_UPDATES_PER_PWM * CTRL_UPDATES_PER_PWM)
+#define PLL_KI_Q16						Q16_FRAC(SPEED_KI_NUM, SPEED_KI_DEN * CTRL_UPDATES_PER_PWM * CTRL_UPDATES_PER_PWM * CTRL_UPDATES_PER_PWM)
 
 
 /* よく使う定数 */
@@ -122,19 +273,40 @@
 
 
 /* 初期化用定数 */
-#define ST_ALIGN_TIME_TICKS				400									/* ≈20ms @20kHz */
+/* *_TICKS・1 周期あたりの量は PWM 周期で書き、CTRL_UPDATES_PER_PWM で制御周期に換算する */
+#define ST_ALIGN_TIME_TICKS				(400 * CTRL_UPDATES_PER_PWM)		/* ≈20ms @20kHz */
 #define ST_ALIGN_ID_Q16					Q16_FRAC(1, 1) 						/* Id=0.1 */
 #define ST_RAMP_IQ_Q16					Q16_FRAC(1, 20)						/* Iq=0.05 から開始 */
-#define ST_RAMP_DIDQ_TICK_Q16   		Q16_FRAC(1, 400)						/* Iqのスルレート(1周期あたり) */
-#define ST_OMEGA_STEP_INIT_Q16			Q16_FRAC(1, 20000)					/* 1.0 turn/s = 1/20k per tick */
-#define ST_OMEGA_STEP_MAX_Q16			Q16_FRAC(1, 2000)					/* 10 turn/s 相当へ上げる例 */
-#define ST_OMEGA_STEP_SLEW_Q16			Q16_FRAC(1, 400000)					/* ωstepスルレート(小さく) */
+#define ST_RAMP_DIDQ_TICK_Q16   		Q16_FRAC(1, 400 * CTRL_UPDATES_PER_PWM)	/* Iqのスルレート(1周期あたり) */
+#define ST_OMEGA_STEP_INIT_T32			TURN32_FRAC(1, 20000 * CTRL_UPDATES_PER_PWM)	/* 1.0 turn/s = 1/20k per tick */
+#define ST_OMEGA_STEP_MAX_T32			TURN32_FRAC(1, 2000 * CTRL_UPDATES_PER_PWM)		/* 10 turn/s 相当へ上げる例 */
+#define ST_OMEGA_STEP_SLEW_T32			TURN32_FRAC(1, 400000LL * CTRL_UPDATES_PER_PWM * CTRL_UPDATES_PER_PWM)	/* ωstepスルレート(小さく) */
 
-#define ST_HANDOFF_MIN_TICKS			600									/* 最低30ms経過 */
-#define ST_HANDOFF_OMEGA_MIN			Q16_FRAC(1, 4000)					/* PLL|ω|>5 turn/s 相当 */
+#define ST_HANDOFF_MIN_TICKS			(600 * CTRL_UPDATES_PER_PWM)		/* 最低30ms経過 */
+#define ST_HANDOFF_OMEGA_MIN_T32		TURN32_FRAC(1, 4000 * CTRL_UPDATES_PER_PWM)		/* PLL|ω|>5 turn/s 相当 */
 #define ST_HANDOFF_EMF_MIN				Q16_FRAC(1, 200)						/* |e| > 0.005 (目安) */
-#define ST_BLEND_TICKS					200									/* ブレンド期間 ≈10ms */
-#define ST_TIMEOUT_TICKS				4000								/* 200msで諦め */
+#define ST_BLEND_TICKS					(200 * CTRL_UPDATES_PER_PWM)		/* ブレンド期間 ≈10ms */
+#define ST_TIMEOUT_TICKS				(4000 * CTRL_UPDATES_PER_PWM)		/* 200msで諦め */
+
+/* SMPx の設定値 → サンプリング時間 [ADC cycles] */
+#define ADC_SMP_CYCLES(S)	((S) == 0 ? 3 : (S) == 1 ? 15 : (S) == 2 ? 28 : (S) == 3 ? 56 : \
+							(S) == 4 ? 84 : (S) == 5 ? 112 : (S) == 6 ? 144 : 480)
+
+/* 電流の標本化（最後の ch のサンプル終了まで）が窓の見積もりに収まること */
+#if (3 * ADC_SMP_CYCLES(SENSE_SMP) + 2 * 12) * (TIM1_CLK_HZ / ADC_CLK_HZ) > SENSE_ACQ_COUNTS
+#error "SENSE_ACQ_COUNTS が電流3ch の標本化時間より短い"
+#endif
+#if ADC_SMP_CYCLES(SHUNT1_SMP) * (TIM1_CLK_HZ / ADC_CLK_HZ) > SHUNT1_ACQ_COUNTS
+#error "SHUNT1_ACQ_COUNTS が I_DC の標本化時間より短い"
+#endif
+
+#if CONF_PWM_DOUBLE_UPDATE && (!CONF_CTRL_SYNC_ISR || CONF_CURRENT_SENSE != SENSE_3SHUNT)
+#error "CONF_PWM_DOUBLE_UPDATE は CONF_CTRL_SYNC_ISR=1 かつ SENSE_3SHUNT で使う（単シャントは上り/下りを窓作りに使う）"
+#endif
+
+#if !MOTOR_CONSTANTS_MEASURED && CONF_CUR_CTRL_MODE != CUR_CTRL_PI
+#error "デッドビート / FCS-MPC は MOTOR_LD_UH/LQ_UH/RS_MOHM のモデルで動く。実測値を入れて MOTOR_CONSTANTS_MEASURED=1 にする"
+#endif
 
 
 #endif /* CONFIG_PHYS_Q16_16_DEFINED */
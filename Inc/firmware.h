@@ -23,21 +23,42 @@ void FW_TIM7_Init(void);
 void FW_ADC1_Init(void);
 void FW_ADC12_InitDualRegular_TIM3_TRGO(void);
 void FW_ADC1_InitInjected_TIM1_CC4(void);
+void FW_ADC2_InitInjected_Shunt(void);
 void FW_DMA_InitForADC(void);
 void FW_StartAll(void);
 
 
 // ===== PWM デューティ更新（0..ARR）=====
 void FW_SetPWMDuties(uint16_t ccr1, uint16_t ccr2, uint16_t ccr3);
+/* 単シャント：上りカウント側と下りカウント側で別の CCR1..3（CCR4 は FW_SetSampleMarker の値）。
+ * 組で受け取り、TIM1 更新割り込みが谷でそろえて切り替える */
+void FW_SetPWMDutiesAsym(uint16_t up1, uint16_t up2, uint16_t up3,
+		uint16_t dn1, uint16_t dn2, uint16_t dn3);
 
 
 // ===== サンプルタイミング（位相マーカ）=====
 void FW_SetSampleMarker(uint16_t ccr4);
+uint8_t FW_SampleLag(void);	// 次に読む電流標本が、直近に渡した CCR の何回前の組の下で取られたか（FOC_SenseSelect へ渡す）
+uint8_t FW_SampledAtPeak(void);	// 直近の電流標本が山（下側 ON の中央）で取られたか
+
+
+// ===== 制御割り込みの実測（CONF_CTRL_SYNC_ISR=1。g_fw_timing をデバッガで読む）=====
+typedef struct
+{
+	uint32_t step_cycles_max;	// 標本完了割り込み → CCR を書き終えるまでの最大 [CPU サイクル]
+	uint32_t late;				// CCR が反映先の UEV に間に合わず、1 周期遅れて反映された回数
+	uint32_t overrun;			// 次の標本が終わるまでに制御が終わらなかった回数
+	uint16_t slack_min;			// CCR を書いた時点で反映先の UEV まで残っていた最小 [TIM1 カウント]
+	uint8_t uev_at_peak;		// 1: 3 シャントで UEV を谷に合わせられなかった
+} FW_Timing_t;
+
+extern FW_Timing_t g_fw_timing;
 
 
 // ===== コールバック（アプリ層が実装）=====
-void APP_OnCurrents(uint16_t iU, uint16_t iV, uint16_t iW);
-void APP_OnVphase(uint16_t *v_adc); // Injectedサンプル
+void APP_OnCurrents(uint16_t iU, uint16_t iV, uint16_t iW); // 3シャント：injected（CNT=CCR4 で標本）
+void APP_OnVphase(uint16_t *v_adc); // 相電圧 V_CC, V_U, V_V, V_W（regular＋DMA）
 void APP_OnVoltage(uint16_t *v_adc);
+void APP_OnShunt(uint16_t s_up, uint16_t s_dn); // 単シャントの I_DC（上り/下り一致の 2 標本）
 
 #endif
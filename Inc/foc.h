@@ -10,8 +10,21 @@
 
 
 #include "fixed_q16.h"
+#include "trig.h"
+#include "pid_q16.h"
+#include "softstart_q16.h"
 
 
+/* 1 組の CCR に対応する標本の読み方（FOC_SenseCounts / FOC_ShuntCounts が使う） */
+typedef struct
+{
+	uint8_t skip;			/* 3 シャント：捨てる相 */
+	uint8_t valid;			/* 0: 窓が無い → 保持 */
+	uint8_t lo;				/* 単シャント：shunt_lo / shunt_hi / shunt_neg と同じ意味 */
+	uint8_t hi;
+	uint8_t neg;
+} FOC_SensePlan_t;
+
 typedef struct
 {
 	q16_t Id_ref_q16;
@@ -25,21 +38,95 @@ typedef struct
 	q16_t Id_i_q16;
 	q16_t Iq_i_q16;
 
-	q16_t Vbus_q16;
+	q16_t Vbus_q16;			/* DC バス電圧[V]（FOC_SetVbus で更新） */
 
 	q16_t v_alpha_q16;
 	q16_t v_beta_q16;
 
+	q16_t i_alpha_q16;		/* FOC_StepFromAdc が求めた iαβ（観測器用） */
+	q16_t i_beta_q16;
+	q16_t i_a_q16;			/* 直近の相電流（デッドタイム補償の向き判定用） */
+	q16_t i_b_q16;
+
+	/* 電流ループの内部状態（インスタンスごとに保持し、FOC_Init で初期化） */
+	pid_q16_t pid_d;
+	pid_q16_t pid_q;
+	softstart_t ss;
+	q16_t u_d_prev_q16;
+	q16_t u_q_prev_q16;
+	q16_t dt_q16;			/* PID/スルー/ソフトスタートの時間単位（1 = 1 制御周期。ゲイン側に Ts を畳み込み済み） */
+	uint8_t svpwm_mode;		/* SVPWM_MODE_SORT / SVPWM_MODE_MINMAX */
+	uint8_t overmod;		/* 1: 2ゾーン過変調（実行中に切替可。dq 電圧の上限半径も毎周期これで決まる） */
+	uint8_t decouple;		/* 1: dq 非干渉化＋BEMF フィードフォワード */
+	q16_t xld_k_q16;		/* 2π·fs·Ld（ωLd[Ω] = ω[turn/周期] × この値） */
+	q16_t xlq_k_q16;		/* 2π·fs·Lq */
+	q16_t psi_k_q16;		/* 2π·fs·ψ */
+	q16_t vbus_inv_q16;		/* 1 / Vbus（FOC_SetVbus で更新） */
+	uint8_t cur_ctrl;		/* CUR_CTRL_PI / CUR_CTRL_DEADBEAT / CUR_CTRL_MPC */
+	q16_t rs_q16;			/* 巻線抵抗[Ω]（デッドビートのモデル） */
+	q16_t ld_fs_q16;		/* Ld/Ts [Ω] */
+	q16_t lq_fs_q16;		/* Lq/Ts [Ω] */
+	q16_t ts_ld_q16;		/* Ts/Ld [1/Ω] */
+	q16_t ts_lq_q16;		/* Ts/Lq [1/Ω] */
+	q16_t db_gain_q16;		/* デッドビートの誤差ゲイン（1 = 2 周期で到達） */
+	q16_t ud_cmd_q16;		/* 前周期の dq 電圧指令[V]（演算遅れ補償用） */
+	q16_t uq_cmd_q16;
+	uint8_t sense_skip;		/* 次周期の標本で捨てる相（0=U, 1=V, 2=W）。窓が最も狭い相 */
+	uint8_t sense_valid;	/* 0: 2相とも窓が足りない → 前回の電流を保持 */
+	uint32_t sense_counts;	/* 直近に使った U/V カウント（パック） */
+	uint8_t shunt_lo;		/* 単シャント：上り側標本で -i を測る相（0=U, 1=V, 2=W） */
+	uint8_t shunt_hi;		/* 単シャント：下り側標本で測る相 */
+	uint8_t shunt_neg;		/* 1: 下り側標本は -i_hi（零ベクトル近傍で使う配置） */
+	FOC_SensePlan_t sense_plan[2];	/* [0] = 直近に求めた CCR の読み方, [1] = その 1 つ前（CCR の反映が遅れた標本用） */
+	uint8_t fw_enable;		/* 1: 電圧フィードバック弱め界磁 */
+	q16_t fw_ki_dt_q16;		/* 弱め界磁の積分ゲイン×Ts [A/V] */
+	q16_t id_fw_q16;		/* 弱め界磁の Id 指令[A]（≤ 0） */
+	q16_t i_lim_q16;		/* dq 電流指令の上限半径[A] */
+	uint8_t mpc_state;		/* FCS-MPC の出力状態（bit0=U, bit1=V, bit2=W 上側 ON） */
+	q16_t id_pred_q16;		/* ダブルアップデート / FCS-MPC：次の標本点の予測 dq 電流[A] */
+	q16_t iq_pred_q16;
+	uint16_t dtc_ccr;		/* デッドタイム補償量[CCR カウント]（0 で無効） */
+	q16_t dtc_knee_inv_q16;	/* 1 / DTC_I_KNEE */
+
 } FOC_t;
 
+/* 1周期分の TIM1 比較値（CCR1..3 = U/V/W, CCR4 = サンプルマーカ）。
+ * 単シャント時は ccr1..3 が上りカウント側、ccrN_dn が下りカウント側（FOC_ShuntPlan が設定） */
+typedef struct
+{
+	uint16_t ccr1;
+	uint16_t ccr2;
+	uint16_t ccr3;
+	uint16_t ccr4;
+	uint16_t ccr1_dn;
+	uint16_t ccr2_dn;
+	uint16_t ccr3_dn;
+} FOC_Pwm_t;
+
 
 void FOC_Init(FOC_t *foc);
+void FOC_SetVbus(FOC_t *foc, q16_t vbus_q16);
+uint32_t FOC_SenseCounts(FOC_t *foc, uint16_t iu, uint16_t iv, uint16_t iw);
+uint32_t FOC_ShuntCounts(FOC_t *foc, uint16_t s_up, uint16_t s_dn);
+uint32_t FOC_PredictCounts(const FOC_t *foc, const RotorFrame_t *f);
+/* 次に読む標本が、直近に求めた CCR（lag = 0）と 1 つ前の CCR（lag = 1）のどちらの下で取られたかを指定する */
+void FOC_SenseSelect(FOC_t *foc, uint8_t lag);
+
+/* 参照用の分割 API（相電流 → vαβ、vαβ → CCR1..4）。制御周期では使わず、
+ * FOC_StepFromAdc と結果が一致することの確認（bench の *_chain）と変調器単体の計測（svpwm_*）にだけ使う */
 void FOC_CurrentLoopStep(FOC_t *foc, q16_t i_a_q16, q16_t i_b_q16,
-		q16_t i_c_q16, q16_t theta_q16);
+		q16_t i_c_q16, const RotorFrame_t *f);
+void FOC_AlphaBetaToSVPWM(FOC_t *foc, uint16_t *ccr1, uint16_t *ccr2,
+		uint16_t *ccr3, uint16_t *ccr4, uint16_t arr);
 
+/* ADC カウント（iU/iV パック）と回転座標から CCR1..4 までを1パスで求める（制御周期で使う API）
+ * （Clarke・逆Clarke を重複させない。結果は上の2関数を順に呼んだ場合と同一） */
+void FOC_StepFromAdc(FOC_t *foc, uint32_t i_uv_counts, const RotorFrame_t *f,
+		uint16_t arr, FOC_Pwm_t *pwm);
 
-void FOC_AlphaBetaToSVPWM(FOC_t *foc, uint16_t *ccr1, uint16_t *ccr2,
-		uint16_t *ccr3, uint16_t arr);
+/* 単シャント：対称な CCR1..3 を上り/下りに非対称化して I_DC の 2 窓を作り、CCR4 を標本点にする。
+ * FOC_StepFromAdc の後に呼び、その周期の標本の読み方（sense_plan[0]）を置き換える */
+void FOC_ShuntPlan(FOC_t *foc, FOC_Pwm_t *pwm, uint16_t arr);
 
 
 #endif
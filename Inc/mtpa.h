@@ -0,0 +1,34 @@
+/* mtpa.h
+ * 目的：
+ *   IPM モータの MTPA（電流あたり最大トルク）指令テーブル。
+ *   電流振幅指令 |is| → (Id, Iq) を線形補間で引く。
+ * 注意：
+ *   テーブルは MTPA_Init で config.h の Ld/Lq/ψ から1回だけ生成する（ISR では補間のみ）。
+ *   MTPA_InitMotor は定数を引数で受ける版（ホスト検査で倍精度の解と比べる）。
+ *   フルスケール電流は 0 < i_fs < 16384 A。k = ψ/(Lq-Ld) が Q16 を超える（ほぼ非突極）ときは Id = 0。
+ *   電流は FOC_t の Id_ref/Iq_ref と同じ正規化値（1.0 = CONFIG_I_MAX_A）。
+ */
+#ifndef MTPA_H
+#define MTPA_H
+
+#include <stdint.h>
+#include "fixed_q16.h"
+
+
+#define MTPA_N		17		/* テーブル点数（|is| = 0..1.0 を等分） */
+
+
+typedef struct
+{
+	q16_t id_q16[MTPA_N];	/* Id 指令（≤ 0） */
+	q16_t iq_q16[MTPA_N];	/* Iq 指令（≥ 0） */
+} MTPA_t;
+
+
+void MTPA_Init(MTPA_t *m, q16_t i_fs_A_q16);
+void MTPA_InitMotor(MTPA_t *m, q16_t i_fs_A_q16, int32_t psi_uwb,
+		int32_t ld_uh, int32_t lq_uh);
+void MTPA_Lookup(const MTPA_t *m, q16_t is_q16, q16_t *id_q16, q16_t *iq_q16);
+
+
+#endif
@@ -0,0 +1,50 @@
+/* trig.h
+ * 目的：
+ *   制御ループ用の sin/cos エンジン（turn 単位の角度入力, Q16.16 出力）。
+ *   角度は turn32_t（2^32 = 1 turn）が基本、turn-Q16 入力は互換用。
+ *   CONF_SINCOS_ENGINE で CORDIC / 1/4波 LUT をコンパイル時に選択する。
+ */
+#ifndef TRIG_H
+#define TRIG_H
+
+
+#include "fixed_q16.h"
+#include "q15x2.h"
+
+
+/* 電気角：2^32 = 1 turn。折り返しは整数オーバーフローに任せる */
+typedef uint32_t turn32_t;
+
+/* 1制御周期で共有する回転座標系（θ とその sin/cos, ω） */
+typedef struct
+{
+	turn32_t theta_t32;
+	q16_t sin_q16;
+	q16_t cos_q16;
+	int32_t omega_t32;		/* 1周期あたりの Δθ（2^32 = 1 turn） */
+	q15x2_t cs_q15x2;		/* (cos, sin) の Q1.15 パック（Park/逆Park 用） */
+} RotorFrame_t;
+
+
+void sincos_turn32(turn32_t th, q16_t *s, q16_t *c);
+void sincos_q16(q16_t th, q16_t *s, q16_t *c);
+
+/* ベクトルモード CORDIC（sincos と atan テーブル共有）。角は turn-Q16（-0.5..0.5） */
+q16_t atan2_turn_q16(q16_t y, q16_t x);
+turn32_t atan2_turn32(q16_t y, q16_t x);
+q16_t hypot_q16(q16_t x, q16_t y);
+void cart2polar_q16(q16_t x, q16_t y, q16_t *mag, q16_t *th);
+
+/* θ から sin/cos を1回だけ計算してフレームに保持する */
+static inline void rotor_frame_update(RotorFrame_t *f, turn32_t theta_t32,
+		int32_t omega_t32)
+{
+	f->theta_t32 = theta_t32;
+	f->omega_t32 = omega_t32;
+	sincos_turn32(theta_t32, &f->sin_q16, &f->cos_q16);
+	f->cs_q15x2 = q15x2_pack(q15_from_q16(f->cos_q16),
+			q15_from_q16(f->sin_q16));
+}
+
+
+#endif
@@ -11,45 +11,31 @@
 #include "foc.h"
 #include "bemf_pll.h"
 #include "encoder.h"
+#include "trig.h"
+#include "mtpa.h"
 
 /* 追加：Q16.16 ユーティリティ */
 #include "fixed_q16.h"
 #include "adc_vcal_q16.h"
 #include "units_q16.h"
+#include "fixed_qn.h"
 
 
 /* 較正状態（他の翻訳単位から参照される） */
 adc_vcal_t g_vcal;
 
-/* ====== CORDIC: 係数も完全整数化 ====== */
-#define CORDIC_ITERS 12
-static const q16_t k_cordic_K_q16 = Q16_FRAC(607252935, 1000000000); /* ≈0.607252935 */
-
-/* atan(2^-i)/(2π) を i に対して **線形補間** で近似する関数 */
-/* アンカー（i=0,4,8,12）を分数→Q16で整数定義し、i間は単純Lerp */
-static const struct
-{
-	uint8_t i;
-	q16_t v;
-}
-k_atan_anchor[] =
-{
-		{ 0, Q16_FRAC(125000000, 1000000000) },		/* 0.1250000000 */
-		{ 4, Q16_FRAC(993426215, 100000000000) },	/* 0.00993426215 */
-		{ 8, Q16_FRAC(62169583, 100000000000) },	/* 0.00062169583 */
-		{ 12, Q16_FRAC(3885619, 100000000000) }		/* 0.00003885619 */
-};
-
 /* --- Startup state machine --- */
 typedef enum
 {
 	ST_STOP = 0, ST_ALIGN, ST_RAMP, ST_BLEND, ST_RUN, ST_FAIL
 } st_t;
 static st_t s_st = ST_STOP;
-static q16_t s_th_forced = 0;			/* 強制角 (turn-Q16) */
-static q16_t s_omg_step = 0;			/* 1周期あたりのΔθ */
+static turn32_t s_th_forced = 0;		/* 強制角 (2^32 = 1 turn) */
+static int32_t s_omg_step = 0;			/* 1周期あたりのΔθ (2^32 = 1 turn) */
 static q16_t s_iq_cmd = 0;				/* 開ループ中の Iq 指令 */
 static q16_t s_tick = 0;				/* 経過tick */
+static turn32_t s_th_ctrl = 0;			/* 次周期の制御角 (2^32 = 1 turn) */
+static int32_t s_omg_ctrl = 0;			/* 次周期の制御角速度 */
 
 static inline q16_t q16_abs(q16_t x)
 {
@@ -64,107 +50,29 @@ static inline q16_t q16_max(q16_t a, q16_t b)
 	return (a > b) ? a : b;
 }
 
-/* 推定BEMFの強さの簡易指標: |e| ≈ max(|eα|,|eβ|) */
+/* 推定BEMFの強さ: |e| = √(eα² + eβ²)（ベクトルモード CORDIC） */
 static inline q16_t emf_strength_q16(const BEMF_PLL_t *o)
 {
-	q16_t ea = q16_abs(o->e_alpha_q16);
-	q16_t eb = q16_abs(o->e_beta_q16);
-	return (ea > eb) ? ea : eb;
-}
-
-static inline q16_t atan_turn_i_q16(int i)
-{
-	if (i <= k_atan_anchor[0].i)
-		return k_atan_anchor[0].v;
-	if (i >= k_atan_anchor[3].i)
-		return k_atan_anchor[3].v;
-	for (int k = 0; k < 3; k++)
-	{
-		int i0 = k_atan_anchor[k].i;
-		int i1 = k_atan_anchor[k + 1].i;
-		if (i >= i0 && i <= i1)
-		{
-			q16_t y0 = k_atan_anchor[k].v;
-			q16_t y1 = k_atan_anchor[k + 1].v;
-			q16_t di = (q16_t) (i - i0);
-			q16_t wi = (q16_t) (i1 - i0);
-			q16_t dy = q16_sub_sat(y1, y0);
-			q16_t t = (q16_t) ((((int64_t) di << 16) + (wi / 2)) / wi); /* di/wi をQ16に */
-			return q16_add_sat(y0, q16_mul(dy, t));
-		}
-	}
-	return k_atan_anchor[3].v;
-}
-
-void sincos_q16(q16_t th, q16_t *s, q16_t *c)
-{
-	th = angle_wrap_q16(th);
-
-	int8_t q = 0;
-	if (th > Q16_ONE / 4)
-	{
-		th -= (Q16_ONE / 2);
-		q = +1;
-	}
-	else if (th < -Q16_ONE / 4)
-	{
-		th += (Q16_ONE / 2);
-		q = -1;
-	}
-
-	q16_t x = k_cordic_K_q16; /* cos */
-	q16_t y = 0; /* sin */
-	q16_t z = th; /* turn-Q16 */
-
-	for (int i = 0; i < CORDIC_ITERS; i++)
-	{
-		q16_t angle_i = atan_turn_i_q16(i); /* 線形補間で取得 */
-		q16_t dx = (y >> i);
-		q16_t dy = (x >> i);
-		if (z >= 0)
-		{
-			x = q16_sub_sat(x, dx);
-			y = q16_add_sat(y, dy);
-			z = q16_sub_sat(z, angle_i);
-		}
-		else
-		{
-			x = q16_add_sat(x, dx);
-			y = q16_sub_sat(y, dy);
-			z = q16_add_sat(z, angle_i);
-		}
-	}
-
-	if (q > 0)
-	{
-		*s = x;
-		*c = -y;
-	}
-	else if (q < 0)
-	{
-		*s = -x;
-		*c = y;
-	}
-	else
-	{
-		*s = y;
-		*c = x;
-	}
+	return hypot_q16(o->e_alpha_q16, o->e_beta_q16);
 }
 
 /* ====== アプリ層本体 ====== */
 static FOC_t s_foc;
 static BEMF_PLL_t s_pll;
+static RotorFrame_t s_frame;		/* 1周期で共有する θ/sin/cos/ω */
+static MTPA_t s_mtpa;				/* |is| → (Id, Iq) 指令テーブル */
 
 static q16_t s_thr_filt_q16 = 0;	/* LPF後の0..1 */
 static q16_t s_mode_speed = 0;		/* 0=トルク直結, 1=速度PI */
 static q16_t s_speed_int_q16 = 0;	/* 速度PIDの積分 */
 static q16_t s_speed_diff_q16 = 0;	/* 速度PIDの微分 */
 
-static volatile uint16_t s_voltage[2];
+static volatile uint16_t s_voltage[2];	/* [0]=V_REF, [1]=V_BATT（DMA の先頭2本） */
+static volatile q16_t s_vbus_q16 = CONFIG_VBUS_NOM_Q16;	/* LPF 後の DC バス電圧[V] */
+static uint16_t s_vbus_tick = 0;		/* FOC への Vbus 反映の間引きカウンタ */
 static volatile uint16_t s_vphase_adc[4];
 static volatile uint16_t s_current[3];
-static volatile q16_t s_iPacked;
+static volatile uint16_t s_shunt[2] = {CONF_I_ADC_MID_COUNTS, CONF_I_ADC_MID_COUNTS};	/* 単シャント：[0]=上り, [1]=下りの I_DC */
 
 uint16_t bat_voltage_buff;
 
@@ -173,20 +81,6 @@ int16_t motor_current_buff[3];
 
 extern Encoder_t s_enc;
 
-static inline q16_t adc_to_q16(uint16_t v)
-{
-	return (q16_t) ((int64_t) v * (int64_t) (Q16_ONE >> 11));
-}
-
-static inline void clarke_q16(q16_t ia, q16_t ib, q16_t ic,
-		q16_t *ialpha, q16_t *ibeta)
-{
-	*ialpha = ia;
-	q16_t two_ib = q16_add_sat(ib, ib);
-	q16_t sum = q16_add_sat(ia, two_ib);
-	*ibeta = q16_mul(sum, Q16_INV_SQRT3);
-}
-
 static inline q16_t throttle_shape_q16(q16_t thr_raw_q16)
 {
 	/* デッドバンド */
@@ -219,7 +113,7 @@ static inline q16_t speed_pid_to_iq_q16(q16_t omega_ref_step_q16,
 {
 	q16_t e = q16_sub_sat(omega_ref_step_q16, omega_meas_step_q16);
 	s_speed_int_q16 = q16_add_sat(s_speed_int_q16, q16_mul(SPEED_KI_Q16, e));
-	s_speed_diff_q16 = q16_div(q16_mul(SPEED_KD_Q16, e), CONFIG_DT_S_Q16);
+	s_speed_diff_q16 = q16_mul(SPEED_KD_FS_Q16, e);
 
 	/* 積分アンチワインドアップ：Iqの範囲に収める */
 	if (s_speed_int_q16 > IQ_MAX_Q16)
@@ -227,7 +121,7 @@ static inline q16_t speed_pid_to_iq_q16(q16_t omega_ref_step_q16,
 	if (s_speed_int_q16 < IQ_MIN_Q16)
 		s_speed_int_q16 = IQ_MIN_Q16; /* 順回転限定なら0～に */
 
-	q16_t out = q16_add_sat(q16_add_sat(q16_mul(SPEED_KP_Q16, e), s_speed_int_q16), s_speed_diff_q16);
+	q16_t out = q16_add_sat(q16_add_sat(q16_mul(SPEED_KP_TICK_Q16, e), s_speed_int_q16), s_speed_diff_q16);
 
 	/* 出力リミット */
 	if (out > IQ_MAX_Q16)
@@ -240,6 +134,7 @@ static inline q16_t speed_pid_to_iq_q16(q16_t omega_ref_step_q16,
 void APP_Init(void)
 {
 	FOC_Init(&s_foc);
+	MTPA_Init(&s_mtpa, CONFIG_I_MAX_A_Q16);
 	BEMF_PLL_Init(&s_pll);
 
 	/*
@@ -249,11 +144,10 @@ void APP_Init(void)
 	adc_vcal_init(&g_vcal, Q16_FRAC(1235, 1000),
 			Q16_FRAC(1, 10));
 
-	s_pll.Ts_q16 = (q16_t) (((int64_t) 1 << 31) / (int64_t) PWM_FREQ_HZ);
 	s_pll.Rs_q16 = CONFIG_RSHUNT_OHM_Q16;
 	s_pll.alpha_q16 = CONF_OBS_ALPHA_Q16;
-	s_pll.kp_q16 = SPEED_KP_Q16;
-	s_pll.ki_q16 = SPEED_KI_Q16;
+	s_pll.kp_q16 = PLL_KP_Q16;
+	s_pll.ki_q16 = PLL_KI_Q16;
 	s_pll.kd_q16 = SPEED_KD_Q16;
 	s_pll.omega_min_q16 = CONF_OMEGA_STEP_MIN_Q16;
 	s_pll.omega_max_q16 = CONF_OMEGA_STEP_MAX_Q16;
@@ -263,19 +157,25 @@ void APP_Init(void)
 	s_st = ST_ALIGN;
 	s_tick = 0;
 	s_th_forced = 0;
-	s_omg_step = ST_OMEGA_STEP_INIT_Q16;
+	s_omg_step = ST_OMEGA_STEP_INIT_T32;
 	s_iq_cmd = 0;
+	s_th_ctrl = 0;
+	s_omg_ctrl = 0;
 }
 
 void APP_OnCurrents(uint16_t iU, uint16_t iV, uint16_t iW)
 {
-	s_iPacked = (q16_t) (iV << 16) | (q16_t) (iU);
-
 	s_current[0] = iU;
 	s_current[1] = iV;
 	s_current[2] = iW;
 }
 
+void APP_OnShunt(uint16_t s_up, uint16_t s_dn)
+{
+	s_shunt[0] = s_up;
+	s_shunt[1] = s_dn;
+}
+
 void APP_OnVphase(uint16_t *v_adc)
 {
 	s_vphase_adc[0] = *v_adc;
@@ -293,38 +193,80 @@ void APP_OnVoltage(uint16_t *v_adc)
 	s_voltage[0] = *v_adc;
 	adc_vcal_update(&g_vcal, (q16_t) s_voltage[0]);
 
+	/* v_adc[1] = バッテリー分圧。較正済み V/LSB と分圧比で [V] にして IIR */
 	s_voltage[1] = *(v_adc + 1);
-	s_voltage[2] = *(v_adc + 2);
-	s_voltage[3] = *(v_adc + 3);
+	q16_t vbus = q16_mul(uq_adc_to_volt(s_voltage[1]), CONFIG_VBUS_DIV_Q16);
+	q16_t vf = s_vbus_q16;
+	s_vbus_q16 = q16_add_sat(vf,
+			q16_mul(CONF_VBUS_LPF_ALPHA_Q16, q16_sub_sat(vbus, vf)));
 }
 
-void APP_Step(void)
+/* 低レートの処理（CONF_CTRL_SYNC_ISR=1 では TIM2 のフラグでメインループから呼ぶ） */
+void APP_Background(void)
 {
 	ENC_Update(&s_enc);
+}
 
-	uint16_t adc1 = (uint16_t) (s_iPacked & 0xFFFF);
-	uint16_t adc2 = (uint16_t) ((s_iPacked >> 16) & 0xFFFF);
+void APP_Step(void)
+{
+	/* PLL には前周期の出力電圧を渡す */
+	q16_t v_alpha = s_foc.v_alpha_q16;
+	q16_t v_beta = s_foc.v_beta_q16;
 
-	q16_t ia = adc_to_q16(adc1);
-	q16_t ib = adc_to_q16(adc2);
-	q16_t ic = q16_sub_sat(0, q16_add_sat(ia, ib));
+	/* Vbus と 1/Vbus は低レートで更新（逆数計算を毎周期しない） */
+	if (++s_vbus_tick >= CONF_VBUS_UPDATE_TICKS)
+	{
+		s_vbus_tick = 0;
+		FOC_SetVbus(&s_foc, s_vbus_q16);
+	}
 
-	q16_t ialpha, ibeta;
-	clarke_q16(ia, ib, ic, &ialpha, &ibeta);
+	/* 制御角の sin/cos はこの周期で1回だけ計算し、PLL/Park/逆Park で共有 */
+	if (s_st == ST_RUN)
+		rotor_frame_update(&s_frame, s_pll.theta_t32, s_pll.omega_t32);
+	else
+		rotor_frame_update(&s_frame, s_th_ctrl, s_omg_ctrl);
 
-	q16_t v_alpha = s_foc.v_alpha_q16;
-	q16_t v_beta = s_foc.v_beta_q16;
+	/* PLL の位相比較は常に PLL 自身の角で行う（強制角で比べると PLL が強制角に引き込まれ、
+	 * ハンドオフ前にロータを独立に追えない）。起動中だけ PLL 用のフレームをもう1つ作る */
+	const RotorFrame_t *pll_frame = &s_frame;
+	RotorFrame_t pll_own;
+	if (s_st != ST_RUN)
+	{
+		rotor_frame_update(&pll_own, s_pll.theta_t32, s_pll.omega_t32);
+		pll_frame = &pll_own;
+	}
 
-	BEMF_PLL_Step(&s_pll, v_alpha, v_beta, ialpha, ibeta);
+	/* ADC カウント → Clarke/Park → 電流PI → 逆Park/逆Clarke → CCR1..4（1パス） */
+	FOC_Pwm_t pwm;
+	/* 標本を取ったときに効いていた CCR の読み方を選ぶ（CCR の書き込みが UEV に遅れた周期は 1 つ前） */
+	FOC_SenseSelect(&s_foc, FW_SampleLag());
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	uint32_t i_uv = FOC_ShuntCounts(&s_foc, s_shunt[0], s_shunt[1]);
+	FOC_StepFromAdc(&s_foc, i_uv, &s_frame, (uint16_t) TIM1_ARR, &pwm);
+	FOC_ShuntPlan(&s_foc, &pwm, (uint16_t) TIM1_ARR);
+#else
+	uint32_t i_uv;
+	if (CONF_PWM_DOUBLE_UPDATE && !FW_SampledAtPeak())
+		i_uv = FOC_PredictCounts(&s_foc, &s_frame);	/* 谷：下側シャントは全相 OFF → 測定ではなくモデル予測（実測帰還は山の 21 kHz） */
+	else if (s_foc.cur_ctrl == CUR_CTRL_MPC && !s_foc.sense_valid)
+		i_uv = FOC_PredictCounts(&s_foc, &s_frame);	/* FCS-MPC で上側 2 相以上 ON：測れる相が 1 つ以下 → 保持ではなく予測 */
+	else
+		i_uv = FOC_SenseCounts(&s_foc, s_current[0], s_current[1],
+				s_current[2]);
+	FOC_StepFromAdc(&s_foc, i_uv, &s_frame, (uint16_t) TIM1_ARR, &pwm);
+#endif
+	FW_SetSampleMarker(pwm.ccr4);
 
-	FOC_CurrentLoopStep(&s_foc, ia, ib, ic, s_pll.theta_q16);
+	BEMF_PLL_Step(&s_pll, pll_frame, v_alpha, v_beta, s_foc.i_alpha_q16,
+			s_foc.i_beta_q16);
 
 	q16_t thr01 = throttle_shape_q16(s_enc.current_q16);
 
+	q16_t is_cmd;
 	if (!s_mode_speed)
 	{
-		/* トルク（Iq）直結：0..1 → 0..IQ_MAX */
-		s_foc.Iq_ref_q16 = q16_mul(thr01, IQ_MAX_Q16);
+		/* トルク直結：0..1 → 0..IQ_MAX */
+		is_cmd = q16_mul(thr01, IQ_MAX_Q16);
 	}
 	else
 	{
@@ -332,11 +274,14 @@ void APP_Step(void)
 		q16_t omega_ref = q16_mul(thr01, CONF_OMEGA_STEP_MAX_Q16);
 		/* 測定ωは PLLの o->omega_q16 をそのまま「turn/step」想定で使用 */
 		q16_t omega_meas = s_pll.omega_q16;
-		s_foc.Iq_ref_q16 = speed_pid_to_iq_q16(omega_ref, omega_meas);
+		is_cmd = speed_pid_to_iq_q16(omega_ref, omega_meas);
 	}
 
-	uint16_t c1, c2, c3;
-	FOC_AlphaBetaToSVPWM(&s_foc, &c1, &c2, &c3, (uint16_t) TIM1_ARR);
+	/* 通常運転では電流振幅指令を MTPA で (Id, Iq) に分ける（起動中は Iq のみ） */
+	if (CONF_MTPA_ENABLE && s_st == ST_RUN)
+		MTPA_Lookup(&s_mtpa, is_cmd, &s_foc.Id_ref_q16, &s_foc.Iq_ref_q16);
+	else
+		s_foc.Iq_ref_q16 = is_cmd;
 
 	/* === Startup control === */
 	s_tick++;
@@ -349,12 +294,14 @@ void APP_Step(void)
 		s_foc.Iq_ref_q16 = 0;
 		/* 角はまだ使わないが、以後のために強制角を0付近に保持 */
 		s_th_forced = 0;
+		s_th_ctrl = 0;
+		s_omg_ctrl = 0;
 		if (s_tick >= ST_ALIGN_TIME_TICKS)
 		{
 			s_st = ST_RAMP;
 			s_tick = 0;
 			s_iq_cmd = 0;
-			s_omg_step = ST_OMEGA_STEP_INIT_Q16;
+			s_omg_step = ST_OMEGA_STEP_INIT_T32;
 		}
 		break;
 
@@ -368,25 +315,19 @@ void APP_Step(void)
 		s_foc.Iq_ref_q16 = s_iq_cmd;
 
 		/* 強制角を回す（ωstepもゆっくり上げる） */
-		if (s_omg_step < ST_OMEGA_STEP_MAX_Q16)
-			s_omg_step = q16_min(ST_OMEGA_STEP_MAX_Q16,
-					q16_add_sat(s_omg_step, ST_OMEGA_STEP_SLEW_Q16));
-		s_th_forced = angle_wrap_q16(q16_add_sat(s_th_forced, s_omg_step));
+		if (s_omg_step < ST_OMEGA_STEP_MAX_T32)
+			s_omg_step = q16_min(ST_OMEGA_STEP_MAX_T32,
+					q16_add_sat(s_omg_step, ST_OMEGA_STEP_SLEW_T32));
+		s_th_forced += (uint32_t) s_omg_step; /* 折り返しは整数オーバーフロー */
 
-		/* FOC側で使う角は「強制角」 */
-		{
-			q16_t s, c;
-			sincos_q16(s_th_forced, &s, &c);
-			/*
-			 * 既存の FOC_CurrentLoopStep 呼び出しを “強制角” で上書きしたい場合は
-			 * ここで再計算して inv_park→SVPWM まで流す or 既存thetaを差し替える実装に。
-			 */
-		}
+		/* FOC側で使う角は「強制角」（次周期の共有フレームに反映） */
+		s_th_ctrl = s_th_forced;
+		s_omg_ctrl = s_omg_step;
 
 		/* ハンドオフ条件：一定時間を過ぎ、かつ BEMFまたはPLL速度が閾値超え */
 		if (s_tick >= ST_HANDOFF_MIN_TICKS)
 		{
-			if (q16_abs(s_pll.omega_q16) >= ST_HANDOFF_OMEGA_MIN
+			if (q16_abs(s_pll.omega_t32) >= ST_HANDOFF_OMEGA_MIN_T32
 					|| emf_strength_q16(&s_pll) >= ST_HANDOFF_EMF_MIN)
 			{
 				s_st = ST_BLEND;
@@ -403,15 +344,15 @@ void APP_Step(void)
 	{
 		/*
 		 * 強制角→PLL角への滑らかな切替
-		 * w = s_tick / ST_BLEND_TICKS (0→1), θ = (1-w)*θ_forced + w*θ_pll
+		 * w = s_tick / ST_BLEND_TICKS (0→1), θ = θ_forced + w*(θ_pll - θ_forced)
+		 * 角度差は符号付き32bitで取るので、折り返し点を跨いでも最短経路で補間する
 		 */
 		q16_t n = (s_tick >= ST_BLEND_TICKS) ? ST_BLEND_TICKS : s_tick;
-		q16_t w = (q16_t) ((((int64_t) n << 31) + (ST_BLEND_TICKS / 2))
-				/ ST_BLEND_TICKS);
-		q16_t w1 = q16_sub_sat(Q16_ONE, w);
+		q30_t w30 = n * QN_FRAC(1, ST_BLEND_TICKS, 30);
+		q16_t w = q30_to_q16(w30);
 
-		q16_t th = q16_add_sat(q16_mul(w1, s_th_forced),
-				q16_mul(w, s_pll.theta_q16));
+		int32_t dth = (int32_t) (s_pll.theta_t32 - s_th_forced);
+		turn32_t th = s_th_forced + (uint32_t) q16_mul(w, dth);
 
 		/* Id をゆっくり 0 へ、Iqは維持 */
 		if (s_foc.Id_ref_q16 > 0)
@@ -422,24 +363,22 @@ void APP_Step(void)
 							q16_sub_sat(s_foc.Id_ref_q16, step) : 0;
 		}
 
-		/*
-		 * θ=th を使って FOC を回す（既存のθ参照箇所をここで差し替える）
-		 * sincos_q16(th, &s, &c); ... （以下略）
-		 */
+		/* θ=th を次周期の共有フレームに反映して FOC を回す */
+		s_th_ctrl = th;
+		s_omg_ctrl = s_pll.omega_t32;
 
 		if (s_tick >= ST_BLEND_TICKS)
 		{
 			s_st = ST_RUN;
 		}
 		s_tick++;
-		(void) th;
 	}
 		break;
 
 	case ST_RUN:
 		/* 以降はPLL角・通常FOC
 		 * 必要なら低速域のみ CCR4 を「T0中央」に寄せる条件を追加：
-		 * if (q16_abs(s_pll.omega_q16) < ST_HANDOFF_OMEGA_MIN) { ccr4 = T0_center; }
+		 * if (q16_abs(s_pll.omega_t32) < ST_HANDOFF_OMEGA_MIN_T32) { ccr4 = T0_center; }
 		 */
 		break;
 
@@ -453,5 +392,10 @@ void APP_Step(void)
 		break;
 	}
 
-	FW_SetPWMDuties(c1, c2, c3);
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	FW_SetPWMDutiesAsym(pwm.ccr1, pwm.ccr2, pwm.ccr3, pwm.ccr1_dn,
+			pwm.ccr2_dn, pwm.ccr3_dn);
+#else
+	FW_SetPWMDuties(pwm.ccr1, pwm.ccr2, pwm.ccr3);
+#endif
 }
@@ -6,35 +6,36 @@
  */
 
 #include "bemf_pll.h"
-#include "app.h"
+#include "trig.h"
 
 
 void BEMF_PLL_Init(BEMF_PLL_t *o)
 {
-	o->theta_q16 = 0;
+	o->theta_t32 = 0;
+	o->omega_t32 = 0;
 	o->omega_q16 = 0;
-	o->integ_q16 = 0;
+	o->integ_t32 = 0;
 	o->i_alpha_prev = 0;
 	o->i_beta_prev = 0;
 	o->di_alpha_q16 = 0;
 	o->di_beta_q16 = 0;
 	o->e_alpha_q16 = 0;
 	o->e_beta_q16 = 0;
+	o->Ls_fs_q16 = 0;
 }
 
-void BEMF_PLL_Step(BEMF_PLL_t *o, q16_t v_alpha_q16, q16_t v_beta_q16,
-		q16_t i_alpha_q16, q16_t i_beta_q16)
+/* 位相比較はフレーム f の sin/cos で行う（f->theta は PLL 自身の角。RUN 中は FOC と共有） */
+void BEMF_PLL_Step(BEMF_PLL_t *o, const RotorFrame_t *f, q16_t v_alpha_q16,
+		q16_t v_beta_q16, q16_t i_alpha_q16, q16_t i_beta_q16)
 {
 	q16_t di_a = q16_sub_sat(i_alpha_q16, o->i_alpha_prev);
 	q16_t di_b = q16_sub_sat(i_beta_q16, o->i_beta_prev);
 
-	q16_t di_alpha_inst = q16_div(di_a, o->Ts_q16);
-	q16_t di_beta_inst = q16_div(di_b, o->Ts_q16);
-
+	/* di は 1 周期あたりの増分のまま平滑化する（L·di/dt = Ls/Ts × di） */
 	q16_t one_minus_alpha = q16_sub_sat(Q16_ONE, o->alpha_q16);
-	o->di_alpha_q16 = q16_add_sat(q16_mul(o->alpha_q16, di_alpha_inst),
+	o->di_alpha_q16 = q16_add_sat(q16_mul(o->alpha_q16, di_a),
 			q16_mul(one_minus_alpha, o->di_alpha_q16));
-	o->di_beta_q16 = q16_add_sat(q16_mul(o->alpha_q16, di_beta_inst),
+	o->di_beta_q16 = q16_add_sat(q16_mul(o->alpha_q16, di_b),
 			q16_mul(one_minus_alpha, o->di_beta_q16));
 
 	o->i_alpha_prev = i_alpha_q16;
@@ -42,8 +43,8 @@ void BEMF_PLL_Step(BEMF_PLL_t *o, q16_t v_alpha_q16, q16_t v_beta_q16,
 
 	q16_t Ri_a = q16_mul(o->Rs_q16, i_alpha_q16);
 	q16_t Ri_b = q16_mul(o->Rs_q16, i_beta_q16);
-	q16_t Ldidt_a = q16_mul(o->Ls_q16, o->di_alpha_q16);
-	q16_t Ldidt_b = q16_mul(o->Ls_q16, o->di_beta_q16);
+	q16_t Ldidt_a = q16_mul(o->Ls_fs_q16, o->di_alpha_q16);
+	q16_t Ldidt_b = q16_mul(o->Ls_fs_q16, o->di_beta_q16);
 
 	q16_t sub_a = q16_add_sat(Ri_a, Ldidt_a);
 	q16_t sub_b = q16_add_sat(Ri_b, Ldidt_b);
@@ -54,22 +55,32 @@ void BEMF_PLL_Step(BEMF_PLL_t *o, q16_t v_alpha_q16, q16_t v_beta_q16,
 	o->e_alpha_q16 = e_a;
 	o->e_beta_q16 = e_b;
 
-	q16_t s, c;
-	sincos_q16(o->theta_q16, &s, &c);
-	q16_t e_q1 = q16_mul(e_a, -s);
-	q16_t e_q2 = q16_mul(e_b, c);
+	q16_t e_q1 = q16_mul(e_a, -f->sin_q16);
+	q16_t e_q2 = q16_mul(e_b, f->cos_q16);
 	q16_t eps = q16_add_sat(e_q1, e_q2);
 
-	o->integ_q16 = q16_add_sat(o->integ_q16, q16_mul(o->ki_q16, eps));
-	if (o->integ_q16 > o->integ_max_q16)
-		o->integ_q16 = o->integ_max_q16;
-	if (o->integ_q16 < o->integ_min_q16)
-		o->integ_q16 = o->integ_min_q16;
+	/* ループフィルタは turn32 スケール（Q16×Q16 → Q32）で積み、微小な Δω も保持する */
+	int32_t integ_max = qn_convert(o->integ_max_q16, Q16_FBITS, 32);
+	int32_t integ_min = qn_convert(o->integ_min_q16, Q16_FBITS, 32);
+	o->integ_t32 = q16_add_sat(o->integ_t32,
+			qn_mul(o->ki_q16, Q16_FBITS, eps, Q16_FBITS, 32));
+	if (o->integ_t32 > integ_max)
+		o->integ_t32 = integ_max;
+	if (o->integ_t32 < integ_min)
+		o->integ_t32 = integ_min;
+
+	int32_t prop = qn_mul(o->kp_q16, Q16_FBITS, eps, Q16_FBITS, 32);
+	int32_t domega = q16_add_sat(prop, o->integ_t32);
+	o->omega_t32 = q16_add_sat(o->omega_t32, domega);
 
-	q16_t prop = q16_mul(o->kp_q16, eps);
-	q16_t domega = q16_add_sat(prop, o->integ_q16);
-	o->omega_q16 = q16_add_sat(o->omega_q16, domega);
+	int32_t omega_max = qn_convert(o->omega_max_q16, Q16_FBITS, 32);
+	int32_t omega_min = qn_convert(o->omega_min_q16, Q16_FBITS, 32);
+	if (o->omega_t32 > omega_max)
+		o->omega_t32 = omega_max;
+	if (o->omega_t32 < omega_min)
+		o->omega_t32 = omega_min;
+	o->omega_q16 = qn_convert(o->omega_t32, 32, Q16_FBITS);
 
-	if (o->omega_q16 > o->omega_max_q16)
-		o->omega_q16 = o->omega_max_q16;
+	/* 角度積分：折り返しは整数オーバーフロー */
+	o->theta_t32 += (uint32_t) o->omega_t32;
 }
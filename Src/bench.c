@@ -0,0 +1,791 @@
+/* bench.c
+ * 目的：
+ *   演算プリミティブを乱数入力＋境界値入力で大量に回し、
+ *   実行時間・飽和率・double 参照値との誤差を g_bench に記録する。
+ * 注意：
+ *   計測ループ内では出力をバッファへ書くだけにして、誤差評価（double 演算）はループ外で行う。
+ *   コピーだけのループを先に計測し、その時間を各結果から差し引く。
+ *   時間源は実機では DWT サイクルカウンタ（1 tick = 1 コアクロック）、
+ *   ホストでは clock_gettime（1 tick = 1 ns）。ホストは分解能が粗いので BENCH_REPS 回繰り返して平均する。
+ */
+
+#include "config.h"
+#include "bench.h"
+
+#if CONF_BENCH_ENABLE
+
+#include "fixed_q16.h"
+#include "pid_q16.h"
+#include "slew_q16.h"
+#include "softstart_q16.h"
+#include "trig.h"
+#include "vec_q16.h"
+#include "foc.h"
+#include "bemf_pll.h"
+#include <math.h>
+#include <string.h>
+
+
+#define BENCH_N			512
+#define BENCH_PI		3.14159265358979323846
+
+BenchReport_t g_bench;
+
+#if defined(__arm__)
+
+#include <stm32f4xx.h>
+
+#define BENCH_REPS		1
+
+static void bench_timer_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	g_bench.tick_hz = SystemCoreClock;
+}
+
+static inline uint32_t bench_ticks(void)
+{
+	return DWT->CYCCNT;
+}
+
+#else
+
+#include <time.h>
+
+#ifndef BENCH_REPS
+#define BENCH_REPS		200
+#endif
+
+static void bench_timer_init(void)
+{
+	g_bench.tick_hz = 1000000000u;
+}
+
+static inline uint32_t bench_ticks(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec);
+}
+
+#endif
+
+static int32_t s_in_a[BENCH_N];
+static int32_t s_in_b[BENCH_N];
+static int32_t s_out[BENCH_N];
+static int32_t s_out2[BENCH_N];
+static uint32_t s_rng = 0x2545F491u;
+static uint32_t s_loop_ticks;
+
+/* 境界値：0, ±1LSB, ±1.0, ±0.5, 最大/最小とその隣, 整数部/小数部のみ */
+static const int32_t k_edge_q16[] =
+{
+	0, 1, -1, Q16_ONE, -Q16_ONE, Q16_HALF, -Q16_HALF,
+	Q16_MAX, Q16_MIN, Q16_MAX - 1, Q16_MIN + 1,
+	0x7FFF0000, -0x7FFF0000, 0x0000FFFF, 0x00010001, 0x00008000
+};
+#define BENCH_N_EDGE	((uint32_t)(sizeof(k_edge_q16) / sizeof(k_edge_q16[0])))
+
+
+/* 誤差の集計 */
+typedef struct
+{
+	double max_err;
+	double sum_err2;
+	uint32_t n;
+	uint32_t sat;
+} BenchAcc_t;
+
+
+static uint32_t bench_rand(void)
+{
+	/* xorshift32 */
+	uint32_t x = s_rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	s_rng = x;
+	return x;
+}
+
+/* 大きさが対数的に分布する乱数（小さい値から飽和域まで満遍なく） */
+static int32_t bench_rand_q16(void)
+{
+	uint32_t sh = bench_rand() & 31u;
+	return (int32_t) bench_rand() >> sh;
+}
+
+/* 先頭に境界値（salt でずらして a/b の組み合わせを変える）、残りを乱数で埋める */
+static void bench_fill(int32_t *buf, uint32_t salt)
+{
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		if (i < BENCH_N_EDGE * BENCH_N_EDGE)
+		{
+			uint32_t k = salt ? (i / BENCH_N_EDGE) : (i % BENCH_N_EDGE);
+			buf[i] = k_edge_q16[k];
+		}
+		else
+		{
+			buf[i] = bench_rand_q16();
+		}
+	}
+}
+
+/* 小振幅のランダムウォーク（PID の測定値など、連続した信号の代用） */
+static void bench_fill_walk(int32_t *buf, int32_t amp, int32_t step)
+{
+	int32_t x = 0;
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		x += (int32_t) (bench_rand() % (uint32_t) (2 * step + 1)) - step;
+		if (x > amp)
+			x = amp;
+		if (x < -amp)
+			x = -amp;
+		buf[i] = x;
+	}
+}
+
+static void bench_acc(BenchAcc_t *a, double got, double ref)
+{
+	if (ref > (double) INT32_MAX)
+	{
+		ref = (double) INT32_MAX;
+		a->sat++;
+	}
+	else if (ref < (double) INT32_MIN)
+	{
+		ref = (double) INT32_MIN;
+		a->sat++;
+	}
+	double e = fabs(got - ref);
+	if (e > a->max_err)
+		a->max_err = e;
+	a->sum_err2 += e * e;
+	a->n++;
+}
+
+/* overhead：ticks から差し引くループ自体の時間（一括カーネルの計測では 0） */
+static void bench_finish(const char *name, uint32_t ticks, uint32_t overhead,
+		uint32_t n_ops, const BenchAcc_t *a, float limit)
+{
+	if (g_bench.count >= BENCH_MAX_RESULTS)
+		return;
+	uint32_t idx = g_bench.count++;
+	BenchResult_t *r = &g_bench.results[idx];
+
+	strncpy(r->name, name, sizeof(r->name) - 1);
+	r->n_ops = n_ops;
+	r->ticks_per_op = (float) (int32_t) (ticks - overhead)
+			/ (float) n_ops;
+	r->ns_per_op = r->ticks_per_op * (1.0e9f / (float) g_bench.tick_hz);
+	r->sat_rate = a->n ? (float) a->sat / (float) a->n : 0.0f;
+	r->max_err_lsb = (float) a->max_err;
+	r->rms_err_lsb = a->n ? (float) sqrt(a->sum_err2 / a->n) : 0.0f;
+	r->max_err_limit_lsb = limit;
+	if (r->max_err_lsb > limit)
+		g_bench.fail_mask |= 1u << idx;
+}
+
+
+/* INIT（計測外）→ STMT を BENCH_REPS 回繰り返した1回あたりの tick 数。
+ * 状態を持つ対象は INIT で毎回初期状態へ戻すので、最後の1回の出力が初回と同じになる */
+#define BENCH_TIME_STMT(TICKS, INIT, STMT) \
+	do { \
+		uint32_t sum_ = 0; \
+		for (uint32_t r_ = 0; r_ < BENCH_REPS; r_++) \
+		{ \
+			INIT; \
+			__asm__ volatile ("" ::: "memory"); \
+			uint32_t t0_ = bench_ticks(); \
+			STMT; \
+			__asm__ volatile ("" ::: "memory"); \
+			sum_ += bench_ticks() - t0_; \
+		} \
+		(TICKS) = (sum_ + BENCH_REPS / 2) / BENCH_REPS; \
+	} while (0)
+
+/* BODY を BENCH_N 回回した時の tick 数 */
+#define BENCH_TIME(TICKS, INIT, BODY) \
+	BENCH_TIME_STMT(TICKS, INIT, \
+			for (uint32_t i = 0; i < BENCH_N; i++) \
+			{ \
+				BODY; \
+			})
+
+
+/* ===== 各プリミティブ ===== */
+
+static void bench_q16_binop(void)
+{
+	BenchAcc_t acc;
+	uint32_t tk;
+
+	bench_fill(s_in_a, 0);
+	bench_fill(s_in_b, 1);
+
+	/* q16_mul：丸め付きなので ±0.5LSB が理論値 */
+	BENCH_TIME(tk, , s_out[i] = q16_mul(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, s_out[i], (double) s_in_a[i] * s_in_b[i] / 65536.0);
+	bench_finish("q16_mul", tk, s_loop_ticks, BENCH_N, &acc, 0.5f);
+
+	BENCH_TIME(tk, , s_out[i] = q16_add_sat(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, s_out[i], (double) s_in_a[i] + s_in_b[i]);
+	bench_finish("q16_add_sat", tk, s_loop_ticks, BENCH_N, &acc, 0.0f);
+
+	BENCH_TIME(tk, , s_out[i] = q16_sub_sat(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, s_out[i], (double) s_in_a[i] - s_in_b[i]);
+	bench_finish("q16_sub_sat", tk, s_loop_ticks, BENCH_N, &acc, 0.0f);
+
+	/* q16_div：0 除算は符号側の飽和値を返す仕様 */
+	BENCH_TIME(tk, , s_out[i] = q16_div(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double ref;
+		if (s_in_b[i] == 0)
+			ref = (s_in_a[i] >= 0) ? 4.0e9 : -4.0e9;
+		else
+			ref = (double) s_in_a[i] * 65536.0 / s_in_b[i];
+		bench_acc(&acc, s_out[i], ref);
+	}
+	bench_finish("q16_div", tk, s_loop_ticks, BENCH_N, &acc, 0.5f);
+
+	BENCH_TIME(tk, , s_out[i] = q16_recip(s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double ref = (s_in_b[i] == 0) ? 4.0e9 : 4294967296.0 / s_in_b[i];
+		bench_acc(&acc, s_out[i], ref);
+	}
+	bench_finish("q16_recip", tk, s_loop_ticks, BENCH_N, &acc, 2.0f);
+}
+
+static void bench_trig(void)
+{
+	BenchAcc_t acc;
+	uint32_t tk;
+	const double k_turn32 = 2.0 * BENCH_PI / 4294967296.0;
+
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		s_in_a[i] = (int32_t) bench_rand();
+	for (uint32_t i = 0; i < 8; i++)
+		s_in_a[i] = (int32_t) (i << 29);		/* 八分円の境界 */
+
+	BENCH_TIME(tk, , sincos_turn32((turn32_t) s_in_a[i], &s_out[i], &s_out2[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double th = (double) (uint32_t) s_in_a[i] * k_turn32;
+		bench_acc(&acc, s_out[i], sin(th) * 65536.0);
+		bench_acc(&acc, s_out2[i], cos(th) * 65536.0);
+	}
+	bench_finish("sincos_turn32", tk, s_loop_ticks, BENCH_N, &acc, 3.0f);
+
+	/* 全周の掃引：2^16 等分の各角に乱数の下位 16bit を足し、BENCH_N ずつ計測・評価する */
+	{
+		const uint32_t chunks = 65536u / BENCH_N;
+		uint32_t tk_sum = 0;
+		memset(&acc, 0, sizeof(acc));
+		for (uint32_t c = 0; c < chunks; c++)
+		{
+			for (uint32_t i = 0; i < BENCH_N; i++)
+				s_in_a[i] = (int32_t) (((c * BENCH_N + i) << 16)
+						| (bench_rand() & 0xFFFFu));
+			BENCH_TIME(tk, , sincos_turn32((turn32_t) s_in_a[i], &s_out[i], &s_out2[i]));
+			tk_sum += tk;
+			for (uint32_t i = 0; i < BENCH_N; i++)
+			{
+				double th = (double) (uint32_t) s_in_a[i] * k_turn32;
+				bench_acc(&acc, s_out[i], sin(th) * 65536.0);
+				bench_acc(&acc, s_out2[i], cos(th) * 65536.0);
+			}
+		}
+		bench_finish("sincos_sweep", (tk_sum + chunks / 2) / chunks, s_loop_ticks,
+				BENCH_N, &acc, 3.0f);
+	}
+
+	bench_fill(s_in_a, 0);
+	bench_fill(s_in_b, 1);
+
+	BENCH_TIME(tk, , s_out[i] = atan2_turn_q16(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double ref = atan2((double) s_in_a[i], (double) s_in_b[i])
+				/ (2.0 * BENCH_PI) * 65536.0;
+		/* ±0.5 turn は同じ角度なので近い方と比べる */
+		if (ref - s_out[i] > 32768.0)
+			ref -= 65536.0;
+		else if (s_out[i] - ref > 32768.0)
+			ref += 65536.0;
+		bench_acc(&acc, s_out[i], ref);
+	}
+	bench_finish("atan2_turn_q16", tk, s_loop_ticks, BENCH_N, &acc, 2.0f);
+
+	/* hypot：CORDIC の誤差は相対的なので、1.0 以上の出力は 2^-16 相対単位で評価する */
+	BENCH_TIME(tk, , s_out[i] = hypot_q16(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double ref = sqrt((double) s_in_a[i] * s_in_a[i]
+				+ (double) s_in_b[i] * s_in_b[i]);
+		double got = s_out[i];
+		double ref_c = (ref > (double) INT32_MAX) ? (double) INT32_MAX : ref;
+		double scale = (ref_c > 65536.0) ? (ref_c / 65536.0) : 1.0;
+		bench_acc(&acc, ref_c + (got - ref_c) / scale, ref);
+	}
+	bench_finish("hypot_q16", tk, s_loop_ticks, BENCH_N, &acc, 2.0f);
+}
+
+static void bench_ctrl(void)
+{
+	BenchAcc_t acc;
+	uint32_t tk;
+	const q16_t dt = CONFIG_DT_S_Q16;
+	const double dt_d = (double) dt / 65536.0;
+
+	/* slew：目標値は ±1.0 の乱数、前回出力は計測で得た値を使う（誤差を累積させない） */
+	bench_fill_walk(s_in_a, Q16_ONE, Q16_ONE / 8);
+	{
+		q16_t prev;
+		BENCH_TIME(tk, prev = 0,
+				prev = q16_slew_step(prev, s_in_a[i], CONFIG_SLEW_UP_V_PER_S_Q16,
+						CONFIG_SLEW_DN_V_PER_S_Q16, dt);
+				s_out[i] = prev);
+	}
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double prev = (i == 0) ? 0.0 : (double) s_out[i - 1];
+		double diff = (double) s_in_a[i] - prev;
+		double rate = (diff > 0) ? CONFIG_SLEW_UP_V_PER_S_Q16 : CONFIG_SLEW_DN_V_PER_S_Q16;
+		double step = rate * dt_d;
+		double ref = s_in_a[i];
+		if (diff > step)
+			ref = prev + step;
+		else if (-diff > step)
+			ref = prev - step;
+		bench_acc(&acc, s_out[i], ref);
+	}
+	bench_finish("q16_slew_step", tk, s_loop_ticks, BENCH_N, &acc, 1.0f);
+
+	/* softstart：dt を 0..10ms で振って上限クランプまで通す */
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		s_in_b[i] = (int32_t) (bench_rand() % (uint32_t) Q16_FRAC(1, 100));
+	{
+		softstart_t ss;
+		BENCH_TIME(tk,
+				softstart_init(&ss, CONFIG_SOFTSTART_RISE_S_Q16);
+				softstart_enable(&ss, 1),
+				s_out[i] = softstart_step(&ss, s_in_b[i]));
+	}
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double prev = (i == 0) ? 0.0 : (double) s_out[i - 1];
+		double ref = prev + 65536.0 / ((double) CONFIG_SOFTSTART_RISE_S_Q16 / 65536.0)
+				* ((double) s_in_b[i] / 65536.0);
+		if (ref > 65536.0)
+		{
+			ref = 65536.0;
+			acc.sat++;
+		}
+		bench_acc(&acc, s_out[i], ref);
+	}
+	bench_finish("softstart_step", tk, s_loop_ticks, BENCH_N, &acc, 1.0f);
+
+	/* PID：測定値は連続信号（ランダムウォーク）、目標値は ±1.0 の乱数 */
+	bench_fill_walk(s_in_a, Q16_ONE, Q16_ONE / 1000);
+	bench_fill_walk(s_in_b, Q16_ONE, Q16_ONE / 4);
+	{
+		static pid_q16_t pid;
+		static q16_t integ[BENCH_N];
+		static q16_t prev_meas[BENCH_N];
+		pid.kp = Q16_FRAC(1, 2);
+		pid.ki = Q16_FRAC(20, 1);
+		pid.kd = Q16_FRAC(1, 1000);
+		pid.out_min = -Q16_ONE;
+		pid.out_max = Q16_ONE;
+
+		/* 計測は状態を記録しない素のループで行い、誤差評価は状態を記録しながら再実行する */
+		BENCH_TIME(tk, pid_q16_init(&pid), s_out[i] = pid_q16_step(&pid, s_in_b[i], s_in_a[i], dt));
+
+		pid_q16_init(&pid);
+		for (uint32_t i = 0; i < BENCH_N; i++)
+		{
+			integ[i] = pid.integrator;
+			prev_meas[i] = pid.prev_meas;
+			s_out[i] = pid_q16_step(&pid, s_in_b[i], s_in_a[i], dt);
+		}
+
+		memset(&acc, 0, sizeof(acc));
+		for (uint32_t i = 0; i < BENCH_N; i++)
+		{
+			double e = (double) s_in_b[i] - s_in_a[i];
+			double P = (double) pid.kp / 65536.0 * e;
+			double D = -(double) pid.kd / 65536.0 * ((double) s_in_a[i] - prev_meas[i]) / dt_d;
+			double I = (double) integ[i] + (double) pid.ki / 65536.0 * e * dt_d;
+			double ref = P + D + I;
+			if (ref > pid.out_max)
+			{
+				ref = pid.out_max;
+				acc.sat++;
+			}
+			else if (ref < pid.out_min)
+			{
+				ref = pid.out_min;
+				acc.sat++;
+			}
+			bench_acc(&acc, s_out[i], ref);
+		}
+		bench_finish("pid_q16_step", tk, s_loop_ticks, BENCH_N, &acc, 16.0f);
+	}
+}
+
+
+/* 一括カーネル：vec_q16 の1回の呼び出しと、同じ処理を要素ごとに書いた素朴なループを比べる */
+static void bench_vec(void)
+{
+	BenchAcc_t acc;
+	uint32_t tk, t0;
+	const q16_t k = -Q16_FRAC(3, 4);
+	const uint32_t n = BENCH_N;
+
+	bench_fill(s_in_a, 0);
+	bench_fill(s_in_b, 1);
+
+	BENCH_TIME_STMT(tk, , vec_q16_mul_sat(s_out, s_in_a, s_in_b, n));
+	BENCH_TIME(t0, , s_out2[i] = q16_mul_ref(s_in_a[i], s_in_b[i]));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, s_out[i], (double) s_in_a[i] * s_in_b[i] / 65536.0);
+	bench_finish("vec_mul_sat", tk, 0, BENCH_N, &acc, 0.5f);
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, s_out2[i], s_out[i]);
+	bench_finish("loop_mul_sat", t0, 0, BENCH_N, &acc, 0.0f);
+
+	BENCH_TIME_STMT(tk, , vec_q16_scale_add(s_out, s_in_a, k, s_in_b, n));
+	BENCH_TIME(t0, , s_out2[i] = q16_add_sat_ref(s_in_a[i], q16_mul_ref(k, s_in_b[i])));
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double kb = (double) k * s_in_b[i] / 65536.0;
+		kb = (kb > (double) Q16_MAX) ? (double) Q16_MAX : kb;
+		kb = (kb < (double) Q16_MIN) ? (double) Q16_MIN : kb;
+		bench_acc(&acc, s_out[i], (double) s_in_a[i] + kb);
+	}
+	bench_finish("vec_scale_add", tk, 0, BENCH_N, &acc, 0.5f);
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, s_out2[i], s_out[i]);
+	bench_finish("loop_scale_add", t0, 0, BENCH_N, &acc, 0.0f);
+
+	/* 内積・統計：±4.0 の連続信号（結果が q16 に収まる範囲） */
+	bench_fill_walk(s_in_a, Q16_FRAC(4, 1), Q16_ONE / 4);
+	bench_fill_walk(s_in_b, Q16_FRAC(4, 1), Q16_ONE / 4);
+	{
+		volatile int64_t sink;
+		int64_t sum;
+		q16_t dot;
+		BENCH_TIME_STMT(tk, , dot = vec_q16_dot(s_in_a, s_in_b, n));
+		BENCH_TIME(t0, sum = 0, sum += (int64_t) q16_mul_ref(s_in_a[i], s_in_b[i]));
+		sink = sum;
+		(void) sink;
+
+		double ref = 0.0;
+		for (uint32_t i = 0; i < BENCH_N; i++)
+			ref += (double) s_in_a[i] * s_in_b[i] / 65536.0;
+		memset(&acc, 0, sizeof(acc));
+		bench_acc(&acc, dot, ref);
+		bench_finish("vec_dot", tk, 0, BENCH_N, &acc, 0.5f);
+		/* 要素ごとに丸める素朴な内積は誤差が n に比例して増える */
+		memset(&acc, 0, sizeof(acc));
+		bench_acc(&acc, (double) sum, ref);
+		bench_finish("loop_dot", t0, 0, BENCH_N, &acc, (float) BENCH_N / 2.0f);
+	}
+	{
+		volatile q16_t sink;
+		q16_t mn, mx;
+		int64_t sum;
+		vec_q16_stats_t st;
+		BENCH_TIME_STMT(tk, , st = vec_q16_stats(s_in_a, n));
+		BENCH_TIME(t0,
+				mn = s_in_a[0];
+				mx = s_in_a[0];
+				sum = 0,
+				if (s_in_a[i] < mn) mn = s_in_a[i];
+				if (s_in_a[i] > mx) mx = s_in_a[i];
+				sum += s_in_a[i]);
+		sink = (q16_t) (sum / BENCH_N) + mn + mx;
+		(void) sink;
+
+		double ref = 0.0;
+		q16_t ref_mn = s_in_a[0], ref_mx = s_in_a[0];
+		for (uint32_t i = 0; i < BENCH_N; i++)
+		{
+			ref += s_in_a[i];
+			ref_mn = (s_in_a[i] < ref_mn) ? s_in_a[i] : ref_mn;
+			ref_mx = (s_in_a[i] > ref_mx) ? s_in_a[i] : ref_mx;
+		}
+		memset(&acc, 0, sizeof(acc));
+		bench_acc(&acc, st.mean, ref / BENCH_N);
+		bench_acc(&acc, st.min, ref_mn);
+		bench_acc(&acc, st.max, ref_mx);
+		bench_finish("vec_stats", tk, 0, BENCH_N, &acc, 0.5f);
+		bench_finish("loop_stats", t0, 0, BENCH_N, &acc, 0.5f);
+	}
+}
+
+/* FOC 電流ループ（FOC_StepFromAdc）：2インスタンスを交互に回し、片方だけ回した場合と出力が一致すること（状態が独立）を確認 */
+static void bench_foc(void)
+{
+	static FOC_t foc_a, foc_b;
+	static RotorFrame_t frame[BENCH_N];
+	static uint32_t counts_a[BENCH_N], counts_b[BENCH_N];
+	const uint16_t arr = (uint16_t) TIM1_ARR;
+	BenchAcc_t acc;
+	uint32_t tk;
+
+	/* 中点まわりの 12bit カウント（iU, iV パック）。B は U/V を入れ替えて別の電流にする */
+	bench_fill_walk(s_in_a, 1500, 40);
+	bench_fill_walk(s_in_b, 1500, 40);
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		uint32_t u = (uint32_t) (CONF_I_ADC_MID_COUNTS + s_in_a[i]);
+		uint32_t v = (uint32_t) (CONF_I_ADC_MID_COUNTS + s_in_b[i]);
+		counts_a[i] = u | (v << 16);
+		counts_b[i] = v | (u << 16);
+		rotor_frame_update(&frame[i], (turn32_t) (i * TURN32_FRAC(1, 97)), 0);
+	}
+
+	BENCH_TIME(tk,
+			FOC_Init(&foc_a);
+			FOC_Init(&foc_b);
+			foc_a.Iq_ref_q16 = Q16_FRAC(1, 5);
+			foc_b.Iq_ref_q16 = -Q16_FRAC(1, 5),
+			FOC_Pwm_t pwm_a;
+			FOC_Pwm_t pwm_b;
+			FOC_StepFromAdc(&foc_a, counts_a[i], &frame[i], arr, &pwm_a);
+			FOC_StepFromAdc(&foc_b, counts_b[i], &frame[BENCH_N - 1 - i], arr,
+					&pwm_b);
+			s_out[i] = foc_a.v_alpha_q16;
+			s_out2[i] = foc_a.v_beta_q16);
+
+	/* 参照：A だけをもう一度最初から回す */
+	FOC_Init(&foc_a);
+	foc_a.Iq_ref_q16 = Q16_FRAC(1, 5);
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		FOC_Pwm_t pwm;
+		FOC_StepFromAdc(&foc_a, counts_a[i], &frame[i], arr, &pwm);
+		bench_acc(&acc, s_out[i], foc_a.v_alpha_q16);
+		bench_acc(&acc, s_out2[i], foc_a.v_beta_q16);
+	}
+	/* 1回の計測で2インスタンス分回しているので、1モータあたりに直す */
+	bench_finish("foc_loop_x2", tk / 2, s_loop_ticks / 2, BENCH_N, &acc, 0.0f);
+}
+
+/* ADC カウント → CCR1..4：旧来の分割チェーン（Clarke 2回, 逆Clarke 2回）と融合カーネルの比較 */
+static void bench_foc_fused(const char *name_chain, const char *name_fused,
+		uint8_t cur_ctrl)
+{
+	static FOC_t foc_init, foc_chain, foc_fused;
+	static RotorFrame_t frame[BENCH_N];
+	static uint16_t ccr_chain[BENCH_N][4];
+	static uint16_t ccr_fused[BENCH_N][4];
+	const uint16_t arr = (uint16_t) TIM1_ARR;
+	BenchAcc_t acc;
+	uint32_t tk_chain, tk_fused;
+
+	/* 中点まわりの 12bit カウント（iU, iV パック） */
+	bench_fill_walk(s_in_a, 1500, 40);
+	bench_fill_walk(s_in_b, 1500, 40);
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		s_out[i] = (int32_t) ((uint32_t) (CONF_I_ADC_MID_COUNTS + s_in_a[i])
+				| ((uint32_t) (CONF_I_ADC_MID_COUNTS + s_in_b[i]) << 16));
+		rotor_frame_update(&frame[i], (turn32_t) (i * TURN32_FRAC(1, 97)), 0);
+	}
+
+	FOC_Init(&foc_init);
+	foc_init.cur_ctrl = cur_ctrl;
+	foc_init.Iq_ref_q16 = Q16_FRAC(1, 5);
+
+	BENCH_TIME(tk_chain, foc_chain = foc_init,
+			q15x2_t i_uv = q15x2_from_adc12((uint32_t) s_out[i],
+					CONF_I_ADC_MID_COUNTS);
+			q16_t ia = q16_from_q15(q15x2_lo(i_uv));
+			q16_t ib = q16_from_q15(q15x2_hi(i_uv));
+			q15x2_t i_ab = clarke_q15x2(i_uv);
+			s_out2[i] = q16_from_q15(q15x2_lo(i_ab)) + q16_from_q15(q15x2_hi(i_ab));
+			FOC_CurrentLoopStep(&foc_chain, ia, ib,
+					q16_sub_sat(0, q16_add_sat(ia, ib)), &frame[i]);
+			FOC_AlphaBetaToSVPWM(&foc_chain, &ccr_chain[i][0], &ccr_chain[i][1],
+					&ccr_chain[i][2], &ccr_chain[i][3], arr));
+
+	BENCH_TIME(tk_fused, foc_fused = foc_init,
+			FOC_Pwm_t pwm;
+			FOC_StepFromAdc(&foc_fused, (uint32_t) s_out[i], &frame[i], arr, &pwm);
+			ccr_fused[i][0] = pwm.ccr1;
+			ccr_fused[i][1] = pwm.ccr2;
+			ccr_fused[i][2] = pwm.ccr3;
+			ccr_fused[i][3] = pwm.ccr4);
+
+	/* 融合カーネルは分割チェーンとビット単位で一致すること */
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		for (uint32_t k = 0; k < 4; k++)
+			bench_acc(&acc, ccr_fused[i][k], ccr_chain[i][k]);
+	bench_finish(name_chain, tk_chain, s_loop_ticks, BENCH_N, &acc, 0.0f);
+	bench_finish(name_fused, tk_fused, s_loop_ticks, BENCH_N, &acc, 0.0f);
+}
+
+/* 1制御周期の角度まわり：PLL・FOC・起動処理がそれぞれ sin/cos を求める形（3回）と、
+ * 共有フレームを1回だけ作る形（APP_Step の RUN 中）を、PLL と融合 FOC カーネル込みで比べる。
+ * 出力 CCR はどちらも同じになること */
+static void bench_tick(void)
+{
+	static FOC_t foc_init, foc;
+	static BEMF_PLL_t pll_init, pll;
+	static uint16_t ccr_sep[BENCH_N], ccr_shared[BENCH_N];
+	const uint16_t arr = (uint16_t) TIM1_ARR;
+	BenchAcc_t acc;
+	uint32_t tk_sep, tk_shared;
+
+	bench_fill_walk(s_in_a, 1500, 40);
+	bench_fill_walk(s_in_b, 1500, 40);
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		s_out[i] = (int32_t) ((uint32_t) (CONF_I_ADC_MID_COUNTS + s_in_a[i])
+				| ((uint32_t) (CONF_I_ADC_MID_COUNTS + s_in_b[i]) << 16));
+
+	FOC_Init(&foc_init);
+	foc_init.Iq_ref_q16 = Q16_FRAC(1, 5);
+	BEMF_PLL_Init(&pll_init);
+	pll_init.Rs_q16 = CONFIG_RS_OHM_Q16;
+	pll_init.alpha_q16 = CONF_OBS_ALPHA_Q16;
+	pll_init.kp_q16 = PLL_KP_Q16;
+	pll_init.ki_q16 = PLL_KI_Q16;
+	pll_init.omega_min_q16 = CONF_OMEGA_STEP_MIN_Q16;
+	pll_init.omega_max_q16 = CONF_OMEGA_STEP_MAX_Q16;
+	pll_init.integ_min_q16 = CONF_PLL_INT_MIN_Q16;
+	pll_init.integ_max_q16 = CONF_PLL_INT_MAX_Q16;
+	pll_init.omega_t32 = TURN32_FRAC(1, 97);
+
+	BENCH_TIME(tk_sep,
+			foc = foc_init;
+			pll = pll_init,
+			RotorFrame_t f_pll;
+			RotorFrame_t f_foc;
+			FOC_Pwm_t pwm;
+			q16_t s;
+			q16_t c;
+			rotor_frame_update(&f_foc, pll.theta_t32, pll.omega_t32);
+			FOC_StepFromAdc(&foc, (uint32_t) s_out[i], &f_foc, arr, &pwm);
+			rotor_frame_update(&f_pll, pll.theta_t32, pll.omega_t32);
+			BEMF_PLL_Step(&pll, &f_pll, foc.v_alpha_q16, foc.v_beta_q16,
+					foc.i_alpha_q16, foc.i_beta_q16);
+			sincos_turn32(pll.theta_t32, &s, &c);
+			s_out2[i] = s + c;
+			ccr_sep[i] = pwm.ccr1);
+
+	BENCH_TIME(tk_shared,
+			foc = foc_init;
+			pll = pll_init,
+			RotorFrame_t f;
+			FOC_Pwm_t pwm;
+			rotor_frame_update(&f, pll.theta_t32, pll.omega_t32);
+			FOC_StepFromAdc(&foc, (uint32_t) s_out[i], &f, arr, &pwm);
+			BEMF_PLL_Step(&pll, &f, foc.v_alpha_q16, foc.v_beta_q16,
+					foc.i_alpha_q16, foc.i_beta_q16);
+			ccr_shared[i] = pwm.ccr1);
+
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+		bench_acc(&acc, ccr_shared[i], ccr_sep[i]);
+	bench_finish("tick_trig_x3", tk_sep, s_loop_ticks, BENCH_N, &acc, 0.0f);
+	bench_finish("tick_frame", tk_shared, s_loop_ticks, BENCH_N, &acc, 0.0f);
+}
+
+/* SVPWM：並び替え方式と min/max 零相注入方式。線間電圧（CCR 差）を double の逆Clarke と比べる */
+static void bench_svpwm_mode(const char *name, uint8_t mode)
+{
+	static FOC_t foc;
+	static uint16_t ccr[BENCH_N][4];
+	const uint16_t arr = (uint16_t) TIM1_ARR;
+	BenchAcc_t acc;
+	uint32_t tk;
+
+	FOC_Init(&foc);
+	foc.svpwm_mode = mode;
+	BENCH_TIME(tk, ,
+			foc.v_alpha_q16 = s_in_a[i];
+			foc.v_beta_q16 = s_in_b[i];
+			FOC_AlphaBetaToSVPWM(&foc, &ccr[i][0], &ccr[i][1], &ccr[i][2],
+					&ccr[i][3], arr));
+
+	memset(&acc, 0, sizeof(acc));
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		double a = (double) s_in_a[i] / 65536.0;
+		double b = (double) s_in_b[i] / 65536.0;
+		double vab = 1.5 * a - 0.8660254037844386 * b;		/* va - vb */
+		double vbc = 1.7320508075688772 * b;				/* vb - vc */
+		bench_acc(&acc, (double) ccr[i][0] - ccr[i][1], vab * arr);
+		bench_acc(&acc, (double) ccr[i][1] - ccr[i][2], vbc * arr);
+	}
+	bench_finish(name, tk, s_loop_ticks, BENCH_N, &acc, 2.0f);
+}
+
+static void bench_svpwm(void)
+{
+	/* 線形変調域（|v| ≤ 0.55）の αβ */
+	for (uint32_t i = 0; i < BENCH_N; i++)
+	{
+		q16_t s, c;
+		sincos_turn32(bench_rand(), &s, &c);
+		q16_t m = (q16_t) (bench_rand() % (uint32_t) Q16_FRAC(55, 100));
+		s_in_a[i] = q16_mul(m, c);
+		s_in_b[i] = q16_mul(m, s);
+	}
+	bench_svpwm_mode("svpwm_sort", SVPWM_MODE_SORT);
+	bench_svpwm_mode("svpwm_minmax", SVPWM_MODE_MINMAX);
+}
+
+void BENCH_Run(void)
+{
+	memset(&g_bench, 0, sizeof(g_bench));
+	g_bench.magic = BENCH_MAGIC;
+	g_bench.version = BENCH_VERSION;
+	bench_timer_init();
+
+	/* ループとロード/ストアだけの時間（各結果から差し引く） */
+	bench_fill(s_in_a, 0);
+	BENCH_TIME(s_loop_ticks, , s_out[i] = s_in_a[i]);
+
+	bench_q16_binop();
+	bench_trig();
+	bench_ctrl();
+	bench_vec();
+	bench_foc();
+	bench_foc_fused("foc_chain", "foc_fused", CUR_CTRL_PI);
+	bench_foc_fused("db_chain", "db_fused", CUR_CTRL_DEADBEAT);
+	bench_foc_fused("mpc_chain", "mpc_fused", CUR_CTRL_MPC);
+	bench_tick();
+	bench_svpwm();
+
+	g_bench.done = 1;
+}
+
+#endif /* CONF_BENCH_ENABLE */
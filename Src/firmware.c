@@ -13,12 +13,53 @@
 #include <stm32f4xx.h>
 
 
-#define ADC_INJBUF_LEN 4
-
-#define ADC_BUF_LEN 5
-static volatile uint16_t s_AdcBuf[ADC_BUF_LEN];
+#define ADC_BUF_LEN 6
+static volatile uint16_t s_AdcBuf[ADC_BUF_LEN];	/* regular：V_REF, V_BATT, V_CC, V_U, V_V, V_W */
+
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+/* 単シャント：CCR1..4 の組（[0]=上りカウント側, [1]=下りカウント側）を世代つきで受け渡す。
+ * Pend = 制御が最後に出した組、Next = 上り側をプリロードへ書いた組、Act = いま出力中の組。
+ * 谷の UEV で、その谷に上り側が載った組へだけ切り替えるので、上りと下りが別の組に分かれない */
+static volatile uint16_t s_CcrPend[2][4];
+static volatile uint16_t s_CcrNext[2][4];
+static volatile uint16_t s_CcrAct[2][4];
+static volatile uint8_t s_GenPend;		/* s_CcrPend の世代（出すたびに +1） */
+static volatile uint8_t s_GenUp;		/* s_CcrNext の世代（次の谷で効く上り側） */
+static volatile uint8_t s_GenAct;		/* s_CcrAct の世代 */
+static volatile uint8_t s_GenPeak;		/* 山の時点で出力中だった世代 = その周期の標本を取った組 */
+static uint8_t s_SampleGen;				/* 直近に読んだ標本の組の世代 */
+#endif
+
+/* 制御を ADC 完了割り込みで回すときは、半周期ごとの CCR 差し替え（TIM1 更新）や
+ * エンコーダ走査に割り込まれるよう 1 段低くする。電圧（regular＋DMA）は制御より低い */
+#if CONF_CTRL_SYNC_ISR
+#define FW_CTRL_IRQ_PRIO	1
+#else
+#define FW_CTRL_IRQ_PRIO	0
+#endif
+#define FW_VOLT_IRQ_PRIO	(FW_CTRL_IRQ_PRIO + 1)
+
+#if (CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT) || CONF_CURRENT_SENSE == SENSE_1SHUNT
+/* CCR1..4 は反映先の UEV までこれ以上残っているときだけ書く
+ * （4 本の書き込みの途中で UEV を跨ぐと、1 周期だけ新旧の CCR が混ざる） */
+#define FW_CCR_MARGIN		64		/* [TIM1 カウント] */
+static uint16_t s_Ccr4 = TIM1_ARR/2;	/* FW_SetSampleMarker で受けて CCR1..3 と一緒に書く */
+#endif
+#if CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT
+static volatile uint8_t s_UevCount;		/* TIM1 UEV の回数（更新割り込みで数える） */
+static uint8_t s_SampleUev;				/* 直近の標本を読んだ時点の s_UevCount */
+static uint8_t s_SampleLag;				/* 次の標本が、直近に書いた CCR の何回前の組の下で取られるか */
+#endif
+#if CONF_CTRL_SYNC_ISR
+static uint32_t s_StepT0;				/* 標本完了割り込みに入った時刻 [DWT サイクル] */
+#endif
+FW_Timing_t g_fw_timing = { .slack_min = 0xFFFF };
 
 volatile uint8_t count_flag = 0;
+static volatile uint8_t s_AtPeak = 1;	/* 直近の injected 変換が山で始めたものか */
+#if CONF_PWM_DOUBLE_UPDATE
+static volatile uint8_t s_UevAtPeak = 1;	/* 直近の UEV（= injected のトリガ）が山だったか */
+#endif
 Encoder_t s_enc;
 
 void FW_InitClocksAndGPIO(void)
@@ -29,6 +70,9 @@ void FW_InitClocksAndGPIO(void)
 	RCC->APB2ENR |= RCC_APB2ENR_TIM1EN | RCC_APB2ENR_ADC1EN;
 	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
 	RCC->APB1ENR |= RCC_APB1ENR_TIM2EN | RCC_APB1ENR_TIM3EN | RCC_APB1ENR_TIM7EN;
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	RCC->APB2ENR |= RCC_APB2ENR_ADC2EN;
+#endif
 }
 
 void FW_InitClock(void)
@@ -118,6 +162,7 @@ void FW_TIM1_InitPWM(void)
 	TIM1->CCR1 = TIM1_ARR/2;
 	TIM1->CCR2 = TIM1_ARR/2;
 	TIM1->CCR3 = TIM1_ARR/2;
+	TIM1->CCR4 = TIM1_ARR/2;
 
 	/* --- CCER: メイン＋コンプリメンタリを両方有効化 --- */
 	/* 極性はまず非反転（H=ON）で開始。必要なら後述の「極性」参照。 */
@@ -142,12 +187,50 @@ void FW_TIM1_InitPWM(void)
 	TIM1->BDTR |= TIM_BDTR_OSSR | TIM_BDTR_OSSI;   /* ★強く推奨（停止/ブレークでOISレベルを適用）*/
 
 	TIM1->BDTR |= TIM_BDTR_MOE;
+
+#if CONF_PWM_DOUBLE_UPDATE
+	/* ダブルアップデート：山と谷の両方で UEV（RCR=0）→ CCR は半周期ごとに反映。
+	 * TRGO も UEV にして、TIM3 ブリッジ経由で両方の UEV ちょうどで regular 変換を起動する */
+	TIM1->RCR = 0;
+	TIM1->CR2 &= ~TIM_CR2_MMS;
+	TIM1->CR2 |=  (2<<TIM_CR2_MMS_Pos);  /* TRGO = Update */
+#elif CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT
+	/* 更新を谷だけに間引く（RCR=1）。標本は山の付近なので、割り込みで計算した CCR は
+	 * 約半周期後の谷で反映され、次の山の標本はその CCR の下で取られる。
+	 * 山・谷のどちらで UEV が起きるかは RCR を書く時点で決まるので、RCR=1 は FW_StartAll で書く */
+	TIM1->RCR = 0;
+#endif
+#if CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT
+	/* UEV を数えて、CCR の書き込みが反映先の UEV に間に合ったかを判定する（FW_SetPWMDuties） */
+	NVIC_SetPriority(TIM1_UP_TIM10_IRQn, 0);
+#endif
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	/* 単シャント：中央揃えでは UEV が山・谷の両方で起きる（RCR=0）。
+	 * 更新割り込みで次の半周期の CCR1..4 をプリロードへ書き、上り/下りを非対称にする */
+	for (uint8_t k = 0; k < 2; k++)
+	{
+		for (uint8_t n = 0; n < 4; n++)
+		{
+			s_CcrPend[k][n] = TIM1_ARR/2;
+			s_CcrNext[k][n] = TIM1_ARR/2;
+			s_CcrAct[k][n] = TIM1_ARR/2;
+		}
+	}
+	TIM1->RCR = 0;
+	TIM1->DIER |= TIM_DIER_UIE;
+	NVIC_SetPriority(TIM1_UP_TIM10_IRQn, 0);
+	NVIC_EnableIRQ(TIM1_UP_TIM10_IRQn);
+#endif
 }
 
 void FW_TIM2_Init(void)
 {
 	TIM2->PSC = 8 - 1;
+#if CONF_CTRL_SYNC_ISR
+	TIM2->ARR = TIM2_CLK_HZ / 8 / BG_FREQ_HZ - 1;
+#else
 	TIM2->ARR = 1000 - 1;
+#endif
 
 	TIM2->DIER = 0x00000001;
 
@@ -157,18 +240,19 @@ void FW_TIM2_Init(void)
 
 void FW_TIM3_InitBridge(void)
 {
-	/* TIM1: TRGO=OC4REF（firmware内のInjected初期化で設定）*/
+	/* TIM1 TRGO（OC4REF / ダブルアップデートでは Update）1 回につき UEV を 1 回だけ出し、
+	 * regular（電圧）の変換を 1 シーケンス起動する。トリガモードは TRGI↑で CEN を立てるだけなので、
+	 * ワンパルスにして 1 周期（ARR+1 カウント）で止める。CEN はソフトで立てない */
+	TIM3->CR1 = TIM_CR1_OPM;
 	TIM3->PSC = 0;
 	TIM3->ARR = 1;
 
 	TIM3->SMCR &= ~(TIM_SMCR_TS | TIM_SMCR_SMS);
 	TIM3->SMCR |= (0 << TIM_SMCR_TS_Pos); /*TS = ITR0 (多くのF4で TIM1)*/
-	TIM3->SMCR |= (6 << TIM_SMCR_SMS_Pos); /*Trigger mode: TRGI↑でUG*/
+	TIM3->SMCR |= (6 << TIM_SMCR_SMS_Pos); /*Trigger mode: TRGI↑で CEN*/
 
 	TIM3->CR2 &= ~TIM_CR2_MMS;
 	TIM3->CR2 |= (2 << TIM_CR2_MMS_Pos); /* TRGO=Update*/
-
-	TIM3->EGR |= TIM_EGR_UG;
 }
 
 void FW_TIM7_Init(void)
@@ -186,24 +270,36 @@ void FW_TIM7_Init(void)
 
 void FW_ADC1_Init(void)
 {
+	/* 電流 3ch だけ短いサンプリング時間（窓の中に収める。SENSE_ACQ_COUNTS と config.h で照合） */
+	const uint32_t i_mask = (7u << (3 * ADC_CH_I_U)) | (7u << (3 * ADC_CH_I_V))
+			| (7u << (3 * ADC_CH_I_W));
 	ADC1->SMPR1 = 0;
-	ADC1->SMPR2 = ADC_SAMPLEING_TIME;
+	ADC1->SMPR2 = (ADC_SAMPLEING_TIME & ~i_mask) | (SENSE_SMP << (3 * ADC_CH_I_U))
+			| (SENSE_SMP << (3 * ADC_CH_I_V)) | (SENSE_SMP << (3 * ADC_CH_I_W));
 
 	FW_ADC12_InitDualRegular_TIM3_TRGO();
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	FW_ADC2_InitInjected_Shunt();
+#else
 	FW_ADC1_InitInjected_TIM1_CC4();
+#endif
 	FW_DMA_InitForADC();
 }
 
 void FW_ADC12_InitDualRegular_TIM3_TRGO(void)
 {
-	ADC1->CR1 = 0;
+	/* 電圧 6ch を 1 シーケンスで（SCAN, L = 6 変換）。電流は injected 側（TIM1 CC4 に同期） */
+	ADC1->CR1 = ADC_CR1_SCAN;
 	ADC1->CR2 = 0;
-	ADC1->SQR1 = 0;
-	ADC1->SQR3 = (ADC_CH_V_REF << 0);
-	ADC1->SQR3 = (ADC_CH_V_BATT << 5);
-	ADC1->SQR3 = (ADC_CH_I_U << 10);
-	ADC1->SQR3 = (ADC_CH_I_V << 15);
-	ADC1->SQR3 = (ADC_CH_I_W << 20);
+	ADC1->SQR1 = ((ADC_BUF_LEN - 1) << ADC_SQR1_L_Pos);
+	ADC1->SQR2 = 0;
+	ADC1->SQR3 = 0;
+	ADC1->SQR3 |= (ADC_CH_V_REF << 0);
+	ADC1->SQR3 |= (ADC_CH_V_BATT << 5);
+	ADC1->SQR3 |= (ADC_CH_V_CC << 10);
+	ADC1->SQR3 |= (ADC_CH_V_U << 15);
+	ADC1->SQR3 |= (ADC_CH_V_V << 20);
+	ADC1->SQR3 |= (ADC_CH_V_W << 25);
 
 	ADC1->CR2 &= ~(ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
 	ADC1->CR2 |= (ADC1_EXTSEL_TIM3_TRGO << ADC_CR2_EXTSEL_Pos);
@@ -220,25 +316,56 @@ void FW_ADC1_InitInjected_TIM1_CC4(void)
 	TIM1->CCMR2 &= ~TIM_CCMR2_OC4M;
 	TIM1->CCMR2 |= (7 << TIM_CCMR2_OC4M_Pos) | TIM_CCMR2_OC4PE;
 
-	/* TIM1 TRGO = OC4REF（TIM3ブリッジにも有効） */
+	/* TIM1 TRGO = OC4REF（TIM3ブリッジにも有効）。ダブルアップデートでは UEV のまま */
+#if !CONF_PWM_DOUBLE_UPDATE
 	TIM1->CR2 &= ~TIM_CR2_MMS;
 	TIM1->CR2 |= (7 << TIM_CR2_MMS_Pos);
+#endif
 
-	/* Injected設定 */
+	/* Injected：I_U, I_V, I_W（JL = 3 変換 → JSQ2..4, 結果は JDR1..3）。
+	 * CNT=CCR4（上りカウント）で標本化し、JEOC で制御を回す */
 	ADC1->JSQR = 0;
-	ADC1->JSQR |= (3 << 20);
-	ADC1->JSQR |= (ADC_CH_V_CC << 0);
-	ADC1->JSQR |= (ADC_CH_V_U << 5);
-	ADC1->JSQR |= (ADC_CH_V_V << 10);
-	ADC1->JSQR |= (ADC_CH_V_W << 15);
+	ADC1->JSQR |= (2 << 20);
+	ADC1->JSQR |= (ADC_CH_I_U << 5);
+	ADC1->JSQR |= (ADC_CH_I_V << 10);
+	ADC1->JSQR |= (ADC_CH_I_W << 15);
 
 	ADC1->CR2 &= ~(ADC_CR2_JEXTSEL | ADC_CR2_JEXTEN);
+#if CONF_PWM_DOUBLE_UPDATE
+	ADC1->CR2 |= (ADC1_JEXTSEL_TIM1_TRGO << ADC_CR2_JEXTSEL_Pos);	/* 山と谷の UEV */
+#else
 	ADC1->CR2 |= (ADC1_JEXTSEL_TIM1_CC4 << ADC_CR2_JEXTSEL_Pos);
+#endif
 	ADC1->CR2 |= (1 << ADC_CR2_JEXTEN_Pos); /* Rising */
 
 	ADC1->CR1 |= ADC_CR1_JEOCIE;
 
-	NVIC_SetPriority(ADC_IRQn, 0);
+	NVIC_SetPriority(ADC_IRQn, FW_CTRL_IRQ_PRIO);
+	NVIC_EnableIRQ(ADC_IRQn);
+}
+
+void FW_ADC2_InitInjected_Shunt(void)
+{
+	/* I_DC を 1 周期に 2 回：TRGO(=OC4REF) の立上り＝上りカウントの CNT=CCR4、
+	 * 立下り＝下りカウントの CNT=CCR4。不連続モードで 1 トリガ 1 変換 → JDR1=上り, JDR2=下り */
+	ADC2->CR1 = 0;
+	ADC2->CR2 = 0;
+	ADC2->SMPR1 = 0;
+	ADC2->SMPR2 = (SHUNT1_SMP << (3 * ADC_CH_I_DC));
+
+	ADC2->JSQR = 0;
+	ADC2->JSQR |= (1 << 20);				/* JL = 2変換（JSQ3, JSQ4） */
+	ADC2->JSQR |= (ADC_CH_I_DC << 10);
+	ADC2->JSQR |= (ADC_CH_I_DC << 15);
+
+	ADC2->CR1 |= ADC_CR1_JDISCEN;
+	ADC2->CR2 |= (ADC2_JEXTSEL_TIM1_TRGO << ADC_CR2_JEXTSEL_Pos);
+	ADC2->CR2 |= (3 << ADC_CR2_JEXTEN_Pos); /* Both edges */
+
+	ADC2->CR1 |= ADC_CR1_JEOCIE;
+	ADC2->CR2 |= ADC_CR2_ADON;
+
+	NVIC_SetPriority(ADC_IRQn, FW_CTRL_IRQ_PRIO);
 	NVIC_EnableIRQ(ADC_IRQn);
 }
 
@@ -264,20 +391,98 @@ void FW_DMA_InitForADC(void)
 
 	DMA2_Stream0->FCR = 0;
 
-	NVIC_SetPriority(DMA2_Stream0_IRQn, 0);
+	NVIC_SetPriority(DMA2_Stream0_IRQn, FW_VOLT_IRQ_PRIO);
 	NVIC_EnableIRQ(DMA2_Stream0_IRQn);
 	DMA2_Stream0->CR |= DMA_SxCR_EN;
 }
 
+#if CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT && !CONF_PWM_DOUBLE_UPDATE
+/* カウンタ起動後に RCR=1 を書き、実際の UEV が谷（DIR=0 に変わった直後）で起きることを確かめる。
+ * 山で起きていたら RCR=0 を 1 回挟んで半周期ずらす。合わせられなければ g_fw_timing.uev_at_peak を立てる */
+static void fw_tim1_uev_to_valley(void)
+{
+	TIM1->RCR = 1;
+	for (uint8_t n = 0; n < 4; n++)
+	{
+		TIM1->SR &= ~TIM_SR_UIF;
+		while (!(TIM1->SR & TIM_SR_UIF))
+		{
+			/* 何もしない */
+		}
+		if (!(TIM1->CR1 & TIM_CR1_DIR))
+			return;
+
+		TIM1->RCR = 0;
+		TIM1->SR &= ~TIM_SR_UIF;
+		while (!(TIM1->SR & TIM_SR_UIF))
+		{
+			/* 何もしない */
+		}
+		TIM1->RCR = 1;
+	}
+	g_fw_timing.uev_at_peak = 1;
+}
+#endif
+
+#if CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT
+/* 直近の標本の後に UEV が来たか（割り込み禁止中は UIF の保留も見る） */
+static inline uint8_t fw_uev_passed(void)
+{
+	return (s_UevCount != s_SampleUev) || (TIM1->SR & TIM_SR_UIF);
+}
+
+/* 次の UEV までの残り [TIM1 カウント] */
+static inline uint16_t fw_counts_to_uev(void)
+{
+	uint16_t cnt = (uint16_t) TIM1->CNT;
+	if (TIM1->CR1 & TIM_CR1_DIR)
+		return cnt;
+#if CONF_PWM_DOUBLE_UPDATE
+	return (uint16_t) (TIM1_ARR - cnt);
+#else
+	return (uint16_t) (2 * TIM1_ARR - cnt);
+#endif
+}
+#endif
+
+#if CONF_CTRL_SYNC_ISR
+/* 標本完了から CCR を書き終えるまでの時間と、反映先の UEV までの残りの最小値を記録する */
+static inline void fw_timing_commit(uint16_t slack, uint8_t late)
+{
+	uint32_t cyc = DWT->CYCCNT - s_StepT0;
+	if (cyc > g_fw_timing.step_cycles_max)
+		g_fw_timing.step_cycles_max = cyc;
+	if (slack < g_fw_timing.slack_min)
+		g_fw_timing.slack_min = slack;
+	g_fw_timing.late += late;
+}
+#endif
+
 void FW_StartAll(void)
 {
+	/* TIM1 の UEV の位置合わせが終わるまで、制御割り込みを走らせない */
+	__disable_irq();
+
+#if CONF_CTRL_SYNC_ISR
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
 	TIM1->EGR |= TIM_EGR_UG;
 	TIM1->CR1 |= TIM_CR1_CEN;
+#if CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT
+#if !CONF_PWM_DOUBLE_UPDATE
+	fw_tim1_uev_to_valley();
+#endif
+	TIM1->SR &= ~TIM_SR_UIF;
+	TIM1->DIER |= TIM_DIER_UIE;
+	NVIC_EnableIRQ(TIM1_UP_TIM10_IRQn);
+#endif
 
 	TIM2->CR1 |= TIM_CR1_CEN;
 
-	TIM3->EGR |= TIM_EGR_UG;
-	TIM3->CR1 |= TIM_CR1_CEN;
+	/* TIM3 は TIM1 TRGO で起動する（ここで CEN を立てると ARR=1 で連続して回り、regular が連発する） */
 
 	TIM7->CR1 |= TIM_CR1_CEN;
 
@@ -286,14 +491,113 @@ void FW_StartAll(void)
 
 void FW_SetPWMDuties(uint16_t ccr1, uint16_t ccr2, uint16_t ccr3)
 {
+#if CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT
+	/* 反映先は標本後の最初の UEV。間に合えば次の標本はこの CCR の下（lag 0）、
+	 * 過ぎていた / 直前で待ったときは次の UEV で反映され、次の標本は 1 つ前の CCR の下（lag 1） */
+	__disable_irq();
+	uint8_t late = fw_uev_passed();
+	uint16_t slack = late ? 0 : fw_counts_to_uev();
+	if (!late && slack < FW_CCR_MARGIN)
+	{
+		while (!fw_uev_passed())
+		{
+			/* 何もしない */
+		}
+		late = 1;
+	}
+	TIM1->CCR1 = ccr1;
+	TIM1->CCR2 = ccr2;
+	TIM1->CCR3 = ccr3;
+	TIM1->CCR4 = s_Ccr4;
+	s_SampleLag = late;
+	__enable_irq();
+	fw_timing_commit(slack, late);
+#else
 	TIM1->CCR1 = ccr1;
 	TIM1->CCR2 = ccr2;
 	TIM1->CCR3 = ccr3;
+#endif
+}
+
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+static inline void fw_ccr_write(volatile const uint16_t *c)
+{
+	TIM1->CCR1 = c[0];
+	TIM1->CCR2 = c[1];
+	TIM1->CCR3 = c[2];
+	TIM1->CCR4 = c[3];
+}
+
+/* 最後に出した組の上り側をプリロードへ書く（次の谷で反映。割り込み禁止中か更新割り込みから呼ぶ） */
+static inline void fw_ccr_load_up(void)
+{
+	for (uint8_t k = 0; k < 2; k++)
+	{
+		for (uint8_t n = 0; n < 4; n++)
+			s_CcrNext[k][n] = s_CcrPend[k][n];
+	}
+	fw_ccr_write(s_CcrNext[0]);
+	s_GenUp = s_GenPend;
+}
+#endif
+
+void FW_SetPWMDutiesAsym(uint16_t up1, uint16_t up2, uint16_t up3,
+		uint16_t dn1, uint16_t dn2, uint16_t dn3)
+{
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	/* 上り/下りの組をまとめて出す。下り中で次の谷まで余裕があれば上り側をここで書き、
+	 * その谷から新しい組にする。間に合わなければ次の山の更新割り込みが書き、1 周期遅れで切り替わる */
+	__disable_irq();
+	s_CcrPend[0][0] = up1;
+	s_CcrPend[0][1] = up2;
+	s_CcrPend[0][2] = up3;
+	s_CcrPend[0][3] = s_Ccr4;
+	s_CcrPend[1][0] = dn1;
+	s_CcrPend[1][1] = dn2;
+	s_CcrPend[1][2] = dn3;
+	s_CcrPend[1][3] = s_Ccr4;
+	s_GenPend++;
+	uint16_t slack = (TIM1->CR1 & TIM_CR1_DIR) ? (uint16_t) TIM1->CNT : 0;
+	uint8_t late = (slack < FW_CCR_MARGIN);
+	if (!late)
+		fw_ccr_load_up();
+	__enable_irq();
+#if CONF_CTRL_SYNC_ISR
+	fw_timing_commit(slack, late);
+#else
+	(void) late;
+#endif
+#else
+	(void) dn1;
+	(void) dn2;
+	(void) dn3;
+	FW_SetPWMDuties(up1, up2, up3);
+#endif
 }
 
 void FW_SetSampleMarker(uint16_t ccr4)
 {
+#if (CONF_CTRL_SYNC_ISR && CONF_CURRENT_SENSE == SENSE_3SHUNT) || CONF_CURRENT_SENSE == SENSE_1SHUNT
+	s_Ccr4 = ccr4;	/* CCR1..3 と同じ UEV に載るよう FW_SetPWMDuties(Asym) でまとめて書く */
+#else
 	TIM1->CCR4 = ccr4;
+#endif
+}
+
+uint8_t FW_SampleLag(void)
+{
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+	return (uint8_t) (s_GenPend - s_SampleGen);
+#elif CONF_CTRL_SYNC_ISR
+	return s_SampleLag;
+#else
+	return 0;
+#endif
+}
+
+uint8_t FW_SampledAtPeak(void)
+{
+	return s_AtPeak;
 }
 
 
@@ -305,29 +609,114 @@ void DMA2_Stream0_IRQHandler(void)
 	ADC1->SR &= ~ADC_SR_STRT;
 
 	uint16_t buff[2] = {0, 0};
+	uint16_t vph[4];
 
 	DMA2->LIFCR = DMA_LIFCR_CTCIF0;
 
 	buff[0] = s_AdcBuf[0];
 	buff[1] = s_AdcBuf[1];
+	vph[0] = s_AdcBuf[2];
+	vph[1] = s_AdcBuf[3];
+	vph[2] = s_AdcBuf[4];
+	vph[3] = s_AdcBuf[5];
 
 	APP_OnVoltage(&buff[0]);
-	APP_OnCurrents(s_AdcBuf[2], s_AdcBuf[3], s_AdcBuf[4]);
+	APP_OnVphase(vph);
 }
 
 void ADC_IRQHandler(void);
 void ADC_IRQHandler(void)
 {
+#if CONF_CURRENT_SENSE == SENSE_3SHUNT
 	if (ADC1->SR & ADC_SR_JEOC)
 	{
-		uint16_t v[ADC_INJBUF_LEN] = {(uint16_t)ADC1->JDR1, (uint16_t)ADC1->JDR2, (uint16_t)ADC1->JDR3, (uint16_t)ADC1->JDR4};
-
-		APP_OnVphase(v);
+#if CONF_CTRL_SYNC_ISR
+		s_StepT0 = DWT->CYCCNT;
+		s_SampleUev = s_UevCount;
+#endif
+#if CONF_PWM_DOUBLE_UPDATE
+		/* 変換を起動した UEV の時点で記録した山/谷（完了時の計数方向は、割り込みが遅れると次の半周期を指す） */
+		s_AtPeak = s_UevAtPeak;
+#endif
+		APP_OnCurrents((uint16_t)ADC1->JDR1, (uint16_t)ADC1->JDR2, (uint16_t)ADC1->JDR3);
 
 		ADC1->SR &= ~ADC_SR_JEOC;
 		ADC1->SR &= ~ADC_SR_JSTRT;
+
+#if CONF_CTRL_SYNC_ISR
+		/* 電流が揃った直後に 1 周期分の制御を回す（CCR は次の UEV で反映） */
+		APP_Step();
+		/* 次の標本がもう終わっている＝1 周期以内に終わらなかった */
+		if (ADC1->SR & ADC_SR_JEOC)
+			g_fw_timing.overrun++;
+#endif
+	}
+#else
+	if (ADC2->SR & ADC_SR_JEOC)
+	{
+#if CONF_CTRL_SYNC_ISR
+		s_StepT0 = DWT->CYCCNT;
+#endif
+		s_SampleGen = s_GenPeak;
+		APP_OnShunt((uint16_t)ADC2->JDR1, (uint16_t)ADC2->JDR2);
+
+		ADC2->SR &= ~ADC_SR_JEOC;
+		ADC2->SR &= ~ADC_SR_JSTRT;
+
+#if CONF_CTRL_SYNC_ISR
+		/* 下り側の標本で 2 本が揃う → 計算した組は、次の谷に間に合えば次周期から反映
+		 * （標本点 t が谷に近いと間に合わず、1 周期遅れる。g_fw_timing.slack_min / late を参照） */
+		APP_Step();
+		if (ADC2->SR & ADC_SR_JEOC)
+			g_fw_timing.overrun++;
+#endif
+	}
+#endif
+}
+
+#if CONF_CURRENT_SENSE == SENSE_1SHUNT
+void TIM1_UP_TIM10_IRQHandler(void);
+void TIM1_UP_TIM10_IRQHandler(void)
+{
+	TIM1->SR &= ~TIM_SR_UIF;
+
+	if (TIM1->CR1 & TIM_CR1_DIR)
+	{
+		/* 山：この周期の標本を取る組を記録し、次の谷で効く上り側を書く（新しい組が出ていればそれ） */
+		s_GenPeak = s_GenAct;
+		if (s_GenPend != s_GenAct)
+			fw_ccr_load_up();
+		else
+			fw_ccr_write(s_CcrAct[0]);
+	}
+	else
+	{
+		/* 谷：上り側がいま載った組へ切り替え、次の山で効く下り側を書く */
+		if (s_GenUp != s_GenAct)
+		{
+			for (uint8_t k = 0; k < 2; k++)
+			{
+				for (uint8_t n = 0; n < 4; n++)
+					s_CcrAct[k][n] = s_CcrNext[k][n];
+			}
+			s_GenAct = s_GenUp;
+		}
+		fw_ccr_write(s_CcrAct[1]);
 	}
 }
+#elif CONF_CTRL_SYNC_ISR
+void TIM1_UP_TIM10_IRQHandler(void);
+void TIM1_UP_TIM10_IRQHandler(void)
+{
+	TIM1->SR &= ~TIM_SR_UIF;
+
+#if CONF_PWM_DOUBLE_UPDATE
+	/* この UEV が injected 変換のトリガ。山の UEV の直後は下り（DIR=1） */
+	s_UevAtPeak = (TIM1->CR1 & TIM_CR1_DIR) ? 1 : 0;
+#endif
+	s_UevCount++;
+}
+#endif
 
 void TIM2_IRQHandler(void);
 void TIM2_IRQHandler(void)
@@ -9,13 +9,20 @@
 
 #include "foc.h"
 #include "config.h"
-#include "firmware.h"
-#include "app.h"
+#include "trig.h"
 /* 追加：Q16.16 制御ユーティリティ */
 #include "fixed_q16.h"
 #include "pid_q16.h"
 #include "slew_q16.h"
 #include "softstart_q16.h"
+#include "q15x2.h"
+#include "fixed_qn.h"
+
+
+/* 電流ループ係数 */
+#define FOC_PID_KP_Q16		Q16_FRAC(36, 1)		/* [V/A]（公称 12 V で従来の 3 /A 相当） */
+#define FOC_PID_KI_V_PER_AS	480					/* [V/(A·s)] */
+#define FOC_PID_KI_TICK_Q16	Q16_FRAC(FOC_PID_KI_V_PER_AS, CTRL_FREQ_HZ)	/* Ki·Ts（1 制御周期あたり） */
 
 
 static inline void park_q16(q16_t ialpha, q16_t ibeta, q16_t sin_t,
@@ -42,54 +49,22 @@ static inline void inv_park_q16(q16_t vd, q16_t vq, q16_t sin_t,
 	*vbeta = q16_add_sat(b1, b2);
 }
 
-// --- SVM セクタ算出（αβ→abcの符号で判定, 1..6） ---
-static inline uint8_t svm_sector_from_alphabeta_q16(q16_t v_alpha,
-		q16_t v_beta)
+// --- 逆Clarke（αβ→abc, 相対値） ---
+static inline void inv_clarke_q16(q16_t v_alpha, q16_t v_beta, q16_t *va,
+		q16_t *vb, q16_t *vc)
 {
-	q16_t va = v_alpha;
-	q16_t vb = q16_add_sat(q16_mul(-(Q16_HALF), v_alpha),
-			q16_mul(Q16_SQRT3_OVER_2, v_beta));
-	q16_t vc = q16_sub_sat(q16_mul(-(Q16_HALF), v_alpha),
-			q16_mul(Q16_SQRT3_OVER_2, v_beta));
-
-	uint8_t a = (va > 0);
-	uint8_t b = (vb > 0);
-	uint8_t c = (vc > 0);
-	uint8_t code = (a << 2) | (b << 1) | c;
-
-	switch (code)
-	{
-	case 0b110:
-		return 1;
-	case 0b101:
-		return 2;
-	case 0b011:
-		return 3;
-	case 0b010:
-		return 4;
-	case 0b001:
-		return 5;
-	case 0b100:
-		return 6;
-	case 0b111:
-	case 0b000:
-	default:
-		return 1;
-	}
+	q16_t h = q16_mul(-(Q16_HALF), v_alpha);
+	q16_t s = q16_mul(Q16_SQRT3_OVER_2, v_beta);
+	*va = v_alpha;
+	*vb = q16_add_sat(h, s);
+	*vc = q16_sub_sat(h, s);
 }
 
-// --- T0,T1,T2 と相デューティ生成（半キャリア正規化, q16） ---
-static inline void svpwm_compute_T012_q16(q16_t v_alpha, q16_t v_beta,
-		uint8_t sector, q16_t *T0_q16, q16_t *T1_q16, q16_t *T2_q16,
+// --- T0,T1,T2 と相デューティ生成（最小値シフト＋並び替え, 半キャリア正規化, q16） ---
+static inline void svpwm_sort_q16(q16_t va, q16_t vb, q16_t vc,
+		q16_t *T0_q16, q16_t *T1_q16, q16_t *T2_q16,
 		q16_t *Da_q16, q16_t *Db_q16, q16_t *Dc_q16)
 {
-	// 逆Clarke（相対値でOK）
-	q16_t va = v_alpha;
-	q16_t vb = q16_add_sat(q16_mul(-(Q16_HALF), v_alpha),
-			q16_mul(Q16_SQRT3_OVER_2, v_beta));
-	q16_t vc = q16_sub_sat(q16_mul(-(Q16_HALF), v_alpha),
-			q16_mul(Q16_SQRT3_OVER_2, v_beta));
-
 	// 最小値で平行移動 → [0, ...]
 	q16_t min_ab = (va < vb) ? va : vb;
 	q16_t min_all = (min_ab < vc) ? min_ab : vc;
@@ -146,6 +121,521 @@ static inline void svpwm_compute_T012_q16(q16_t v_alpha, q16_t v_beta,
 		*Dc_q16 = Dc;
 }
 
+// --- 3相の最大/最小/中間の相番号（同値でも3つが重ならない比較順） ---
+static inline void abc_order(const q16_t v[3], uint32_t *imax, uint32_t *imin,
+		uint32_t *imid)
+{
+	*imax = (v[0] >= v[1]) ? ((v[0] >= v[2]) ? 0 : 2) : ((v[1] >= v[2]) ? 1 : 2);
+	*imin = (v[0] < v[1]) ? ((v[0] < v[2]) ? 0 : 2) : ((v[1] < v[2]) ? 1 : 2);
+	*imid = 3 - *imax - *imin;
+}
+
+// --- min/max 零相注入 SVPWM（並び替え無し, 半キャリア正規化, q16） ---
+// D = v - (vmax + vmin)/2 + 1/2。T1/T2 は min/mid/max の相番号から直接求める
+static inline void svpwm_minmax_q16(q16_t va, q16_t vb, q16_t vc,
+		q16_t *T0_q16, q16_t *T1_q16, q16_t *T2_q16,
+		q16_t *Da_q16, q16_t *Db_q16, q16_t *Dc_q16)
+{
+	const q16_t v[3] = { va, vb, vc };
+	uint32_t imax, imin, imid;
+	abc_order(v, &imax, &imin, &imid);
+
+	int32_t vmax = v[imax];
+	int32_t vmin = v[imin];
+	int32_t offset = Q16_HALF - ((vmax + vmin) >> 1);
+
+	int32_t D[3];
+	for (int k = 0; k < 3; k++)
+	{
+		int32_t d = v[k] + offset;
+		d = (d < 0) ? 0 : d;
+		D[k] = (d > Q16_ONE) ? Q16_ONE : d;
+	}
+
+	q16_t T1 = v[imid] - vmin;
+	q16_t T2 = vmax - v[imid];
+	q16_t T0 = Q16_ONE - (vmax - vmin);
+
+	*T0_q16 = (T0 < 0) ? 0 : T0;
+	*T1_q16 = T1;
+	*T2_q16 = T2;
+	*Da_q16 = D[0];
+	*Db_q16 = D[1];
+	*Dc_q16 = D[2];
+}
+
+static inline void svpwm_from_abc_q16(uint8_t mode, q16_t va, q16_t vb,
+		q16_t vc, q16_t *T0_q16, q16_t *T1_q16, q16_t *T2_q16,
+		q16_t *Da_q16, q16_t *Db_q16, q16_t *Dc_q16)
+{
+	if (mode == SVPWM_MODE_MINMAX)
+		svpwm_minmax_q16(va, vb, vc, T0_q16, T1_q16, T2_q16, Da_q16, Db_q16,
+				Dc_q16);
+	else
+		svpwm_sort_q16(va, vb, vc, T0_q16, T1_q16, T2_q16, Da_q16, Db_q16,
+				Dc_q16);
+}
+
+// --- 2ゾーン過変調（相電圧上で処理） ---
+// ゾーン1：六角形をはみ出す分は角度を保ったまま六角形上へ縮める（vmax - vmin ≤ 1）
+// ゾーン2：|v| が OVM_ZONE2_START を超えたら中間相を近い側の端へ寄せ、頂点（6ステップ）へ移す
+#define OVM_R1_SQ_Q16		((q16_t) (((int64_t) OVM_ZONE2_START_Q16 * OVM_ZONE2_START_Q16) >> Q16_FBITS))
+#define OVM_R2_SQ_Q16		((q16_t) (((int64_t) V_LIMIT_OVM_Q16 * V_LIMIT_OVM_Q16) >> Q16_FBITS))
+#define OVM_K_SCALE_Q16		((q16_t) (((int64_t) 1 << (2 * Q16_FBITS)) / (OVM_R2_SQ_Q16 - OVM_R1_SQ_Q16)))
+
+static inline void svpwm_overmod_abc_q16(q16_t v_alpha, q16_t v_beta,
+		q16_t *va, q16_t *vb, q16_t *vc)
+{
+	q16_t v[3] = { *va, *vb, *vc };
+	uint32_t imax, imin, imid;
+	abc_order(v, &imax, &imin, &imid);
+
+	q16_t span = v[imax] - v[imin];
+	if (span > Q16_ONE)
+	{
+		q16_t g = q16_recip(span);
+		v[0] = q16_mul(v[0], g);
+		v[1] = q16_mul(v[1], g);
+		v[2] = q16_mul(v[2], g);
+	}
+
+	q16_t mag2 = q16_add_sat(q16_mul(v_alpha, v_alpha), q16_mul(v_beta, v_beta));
+	if (mag2 > OVM_R1_SQ_Q16)
+	{
+		q16_t k = q16_mul(mag2 - OVM_R1_SQ_Q16, OVM_K_SCALE_Q16);
+		if (k > Q16_ONE)
+			k = Q16_ONE;
+		q16_t vext = (v[imax] - v[imid] < v[imid] - v[imin]) ? v[imax] : v[imin];
+		v[imid] += q16_mul(k, vext - v[imid]);
+	}
+
+	*va = v[0];
+	*vb = v[1];
+	*vc = v[2];
+}
+
+// --- サンプル点：半キャリア T0/2, T1, T2, T0/2 のうち長いアクティブベクトルの中央 ---
+static inline q16_t svpwm_sample_point_q16(q16_t T0, q16_t T1, q16_t T2)
+{
+	if (T1 >= T2)
+		return q16_add_sat(q16_mul(T0, Q16_HALF), q16_mul(T1, Q16_HALF));
+
+	q16_t t0h = q16_mul(T0, Q16_HALF);
+	q16_t t2h = q16_mul(T2, Q16_HALF);
+	return q16_add_sat(q16_add_sat(t0h, T1), t2h);
+}
+
+static inline uint16_t duty_to_ccr(q16_t D, uint16_t arr)
+{
+	return (uint16_t) ((((int64_t) D) * arr) >> Q16_FBITS);
+}
+
+// --- デッドタイム補償：電流が相から流れ出る向き(i>0)ではデッドタイム中に下側ダイオードが導通して
+// 電圧が欠けるので CCR を増やし、逆向きでは減らす。零電流付近は |i| < knee で線形に絞って切替をなめらかにする ---
+static inline uint16_t dtc_apply(const FOC_t *foc, uint16_t ccr, q16_t i,
+		uint16_t arr)
+{
+	q16_t g = q16_mul(i, foc->dtc_knee_inv_q16);
+	g = (g > Q16_ONE) ? Q16_ONE : ((g < -Q16_ONE) ? -Q16_ONE : g);
+	int32_t c = (int32_t) ccr
+			+ ((g * (int32_t) foc->dtc_ccr + Q16_HALF) >> Q16_FBITS);
+	c = (c < 0) ? 0 : c;
+	return (uint16_t) ((c > arr) ? arr : c);
+}
+
+static inline void dtc_apply3(const FOC_t *foc, uint16_t *ccr1,
+		uint16_t *ccr2, uint16_t *ccr3, uint16_t arr)
+{
+	if (foc->dtc_ccr == 0)
+		return;
+	q16_t i_c = q16_sub_sat(0, q16_add_sat(foc->i_a_q16, foc->i_b_q16));
+	*ccr1 = dtc_apply(foc, *ccr1, foc->i_a_q16, arr);
+	*ccr2 = dtc_apply(foc, *ccr2, foc->i_b_q16, arr);
+	*ccr3 = dtc_apply(foc, *ccr3, i_c, arr);
+}
+
+// --- 標本の読み方は CCR と一緒に決まり、[0] に積んで古い方を [1] に送る。CCR の反映が 1 周期遅れた
+// 標本は FOC_SenseSelect で [1] を選んで読む（選ばなければ従来どおり直近の読み方） ---
+static inline void foc_plan_store(FOC_t *foc)
+{
+	foc->sense_plan[0].skip = foc->sense_skip;
+	foc->sense_plan[0].valid = foc->sense_valid;
+	foc->sense_plan[0].lo = foc->shunt_lo;
+	foc->sense_plan[0].hi = foc->shunt_hi;
+	foc->sense_plan[0].neg = foc->shunt_neg;
+}
+
+static inline void foc_plan_push(FOC_t *foc)
+{
+	foc->sense_plan[1] = foc->sense_plan[0];
+	foc_plan_store(foc);
+}
+
+// --- 電流サンプリング窓：下側 ON の窓はカウンタ頂点 (CNT = ARR) を中心に 2·(ARR - CCR) カウント。
+// 窓が最も狭い（CCR が最大の）相を捨てて残り2相を測り、3相目は Kirchhoff で復元する。
+// CCR4 は残り2相の窓が両方開いてからデッドタイム＋整定時間後に置く ---
+static inline uint16_t foc_sense_plan(FOC_t *foc, uint16_t ccr1, uint16_t ccr2,
+		uint16_t ccr3, uint16_t arr, uint16_t ccr4_center)
+{
+	if (!CONF_SENSE_WINDOW_ENABLE)
+	{
+		foc->sense_skip = 2;
+		foc->sense_valid = 1;
+		foc_plan_push(foc);
+		return ccr4_center;
+	}
+
+	uint8_t skip = 0;
+	uint16_t hi = ccr1, mid;
+	if (ccr2 > hi)
+	{
+		skip = 1;
+		hi = ccr2;
+	}
+	if (ccr3 > hi)
+	{
+		skip = 2;
+		hi = ccr3;
+	}
+	mid = (skip == 0) ? ((ccr2 > ccr3) ? ccr2 : ccr3)
+			: ((skip == 1) ? ((ccr1 > ccr3) ? ccr1 : ccr3)
+					: ((ccr1 > ccr2) ? ccr1 : ccr2));
+
+	int32_t settle = DTG_TICKS + duty_to_ccr(Q16_MARGIN_2PCT, arr);
+	foc->sense_skip = skip;
+	foc->sense_valid = (2 * ((int32_t) arr - mid) >= settle + SENSE_ACQ_COUNTS);
+	foc_plan_push(foc);
+
+	int32_t t = (int32_t) mid + settle;
+	return (uint16_t) ((t > (int32_t) arr - 1) ? (int32_t) arr - 1 : t);
+}
+
+// --- 単シャント（DC リンク）：I_DC は上側 ON の相の電流の和。CCR4 の一致は上りカウントと下りカウントで
+// 1 回ずつ起きるので、その 2 時点 t で異なるアクティブベクトルが出るよう、相ごとに CCR を
+// 上り c+s / 下り c-s にずらす（オン時間 2c は不変）。標本 [t, t±acq] の中に辺が無く、
+// 直前の辺から settle 以上経っていることを条件に |s| 最小を選ぶ ---
+static inline int32_t foc_shunt_shift(int32_t c, int32_t t, uint8_t up_on,
+		uint8_t dn_on, int32_t settle)
+{
+	int32_t lo = -0x7FFF, hi = 0x7FFF;
+	if (up_on)
+		lo = t + SHUNT1_ACQ_COUNTS - c;
+	else
+		hi = t - settle - c;
+	if (dn_on)
+		hi = (c - t - settle < hi) ? c - t - settle : hi;
+	else
+		lo = (c - t + SHUNT1_ACQ_COUNTS > lo) ? c - t + SHUNT1_ACQ_COUNTS : lo;
+
+	if (lo > hi)
+		return (lo + hi) / 2;
+	return (lo > 0) ? lo : ((hi < 0) ? hi : 0);
+}
+
+static inline uint8_t foc_shunt_apply(int32_t c, int32_t s, int32_t t,
+		uint8_t up_on, uint8_t dn_on, int32_t settle, int32_t top,
+		uint16_t *ccr_up, uint16_t *ccr_dn)
+{
+	// 上り/下りとも [0, top] に収まる範囲でずらす（オン時間 u + d = 2c を保つ）
+	int32_t u_min = (2 * c - top > 0) ? 2 * c - top : 0;
+	int32_t u_max = (2 * c < top) ? 2 * c : top;
+	int32_t u = c + s;
+	u = (u < u_min) ? u_min : ((u > u_max) ? u_max : u);
+	int32_t d = 2 * c - u;
+	*ccr_up = (uint16_t) u;
+	*ccr_dn = (uint16_t) d;
+
+	uint8_t ok_up = up_on ? (u >= t + SHUNT1_ACQ_COUNTS) : (u <= t - settle);
+	uint8_t ok_dn = dn_on ? (d >= t + settle) : (d <= t - SHUNT1_ACQ_COUNTS);
+	return ok_up && ok_dn;
+}
+
+static inline q16_t foc_clamp_q16(q16_t x, q16_t lim)
+{
+	return (x > lim) ? lim : ((x < -lim) ? -lim : x);
+}
+
+/* d軸優先の円制限で q軸に残る振幅 √(lim² - ud²) */
+static inline q16_t foc_lim_q_q16(q16_t lim, q16_t ud)
+{
+	return q16_sqrt(q16_mul(lim, lim) - q16_mul(ud, ud));
+}
+
+// --- PI：PID＋非干渉化FF＋スルーレート（電圧[V]） ---
+static inline void foc_dq_pi(FOC_t *foc, q16_t id_A_q16, q16_t iq_A_q16,
+		q16_t Id_ref_A_q16, q16_t Iq_ref_A_q16, int32_t omega_t32, q16_t lim,
+		q16_t *ud_out, q16_t *uq_out)
+{
+	/* フィードフォワード [V]：
+	 *   vd_ff = -ωLq·iq,  vq_ff = ωLd·id + ωψ
+	 * （ω は turn/周期の Q32、係数は 2π·fs を含む Q16） */
+	q16_t ffd = 0;
+	q16_t ffq = 0;
+	if (foc->decouple)
+	{
+		q16_t xd = qn_mul(omega_t32, 32, foc->xld_k_q16, Q16_FBITS, Q16_FBITS);
+		q16_t xq = qn_mul(omega_t32, 32, foc->xlq_k_q16, Q16_FBITS, Q16_FBITS);
+		q16_t emf = qn_mul(omega_t32, 32, foc->psi_k_q16, Q16_FBITS, Q16_FBITS);
+		ffd = -q16_mul(xq, iq_A_q16);
+		ffq = q16_add_sat(q16_mul(xd, id_A_q16), emf);
+	}
+
+	/* PID 出力[V]に FF を足した合計を d軸優先で半径 lim の円に制限する：
+	 * |vd| ≤ Vlim, |vq| ≤ √(Vlim² - vd²)。
+	 * PID の出力上限は「制限 − FF」にして、制限中の積分ワインドアップを防ぐ。
+	 * スルーレート制限は PID 分だけに掛ける（FF は速度に追従させる） */
+	foc->pid_d.out_max = q16_sub_sat(lim, ffd);
+	foc->pid_d.out_min = q16_sub_sat(-lim, ffd);
+	q16_t ud = pid_q16_step(&foc->pid_d, Id_ref_A_q16, id_A_q16, foc->dt_q16);
+	ud = q16_slew_step(foc->u_d_prev_q16, ud, CONFIG_SLEW_UP_V_PER_TICK_Q16,
+			CONFIG_SLEW_DN_V_PER_TICK_Q16, foc->dt_q16);
+	foc->u_d_prev_q16 = ud;
+	ud = foc_clamp_q16(q16_add_sat(ud, ffd), lim);
+
+	q16_t lim_q = foc_lim_q_q16(lim, ud);
+	foc->pid_q.out_max = q16_sub_sat(lim_q, ffq);
+	foc->pid_q.out_min = q16_sub_sat(-lim_q, ffq);
+	q16_t uq = pid_q16_step(&foc->pid_q, Iq_ref_A_q16, iq_A_q16, foc->dt_q16);
+	uq = q16_slew_step(foc->u_q_prev_q16, uq, CONFIG_SLEW_UP_V_PER_TICK_Q16,
+			CONFIG_SLEW_DN_V_PER_TICK_Q16, foc->dt_q16);
+	foc->u_q_prev_q16 = uq;
+	uq = foc_clamp_q16(q16_add_sat(uq, ffq), lim_q);
+
+	*ud_out = ud;
+	*uq_out = uq;
+}
+
+// --- モデル予測：2 周期後に指令へ到達させる電圧[V]（制限前） ---
+/* モデル（前進オイラー, Ts = 1 制御周期）：
+ *   L·di/dt = v - R·i - (結合項)、 結合項 d: -ωLq·iq, q: ωLd·id + ωψ
+ * 今周期に出ている電圧は前周期の指令 (ud_cmd, uq_cmd) なので、これで次の標本点の電流 i(k+1) を予測する */
+static inline void foc_dq_advance(const FOC_t *foc, q16_t id_A_q16,
+		q16_t iq_A_q16, int32_t omega_t32, q16_t *id1_out, q16_t *iq1_out)
+{
+	q16_t xd = qn_mul(omega_t32, 32, foc->xld_k_q16, Q16_FBITS, Q16_FBITS);
+	q16_t xq = qn_mul(omega_t32, 32, foc->xlq_k_q16, Q16_FBITS, Q16_FBITS);
+	q16_t emf = qn_mul(omega_t32, 32, foc->psi_k_q16, Q16_FBITS, Q16_FBITS);
+
+	q16_t ld_d = q16_add_sat(q16_sub_sat(foc->ud_cmd_q16,
+			q16_mul(foc->rs_q16, id_A_q16)), q16_mul(xq, iq_A_q16));
+	q16_t lq_d = q16_sub_sat(q16_sub_sat(foc->uq_cmd_q16,
+			q16_mul(foc->rs_q16, iq_A_q16)),
+			q16_add_sat(q16_mul(xd, id_A_q16), emf));
+	*id1_out = q16_add_sat(id_A_q16, q16_mul(ld_d, foc->ts_ld_q16));
+	*iq1_out = q16_add_sat(iq_A_q16, q16_mul(lq_d, foc->ts_lq_q16));
+}
+
+static inline void foc_dq_predict(const FOC_t *foc, q16_t id_A_q16,
+		q16_t iq_A_q16, q16_t Id_ref_A_q16, q16_t Iq_ref_A_q16,
+		int32_t omega_t32, q16_t gain, q16_t *ud_out, q16_t *uq_out)
+{
+	/* 1) 演算遅れ補償：i(k+1) を予測（foc_dq_advance）
+	 * 2) i(k+1) から 1 周期で指令に届く電圧を求める（gain < 1 で L 誤差に強く）
+	 *    v = R·i(k+1) + 結合項 + gain·(L/Ts)·(i_ref - i(k+1)) */
+	q16_t xd = qn_mul(omega_t32, 32, foc->xld_k_q16, Q16_FBITS, Q16_FBITS);
+	q16_t xq = qn_mul(omega_t32, 32, foc->xlq_k_q16, Q16_FBITS, Q16_FBITS);
+	q16_t emf = qn_mul(omega_t32, 32, foc->psi_k_q16, Q16_FBITS, Q16_FBITS);
+	q16_t id1, iq1;
+	foc_dq_advance(foc, id_A_q16, iq_A_q16, omega_t32, &id1, &iq1);
+
+	q16_t kd = q16_mul(gain, foc->ld_fs_q16);
+	q16_t kq = q16_mul(gain, foc->lq_fs_q16);
+	q16_t ud = q16_sub_sat(q16_mul(foc->rs_q16, id1), q16_mul(xq, iq1));
+	*ud_out = q16_add_sat(ud, q16_mul(kd, q16_sub_sat(Id_ref_A_q16, id1)));
+
+	q16_t uq = q16_add_sat(q16_mul(foc->rs_q16, iq1),
+			q16_add_sat(q16_mul(xd, id1), emf));
+	*uq_out = q16_add_sat(uq, q16_mul(kq, q16_sub_sat(Iq_ref_A_q16, iq1)));
+}
+
+// --- デッドビート：予測電圧を d軸優先の円で制限 ---
+static inline void foc_dq_deadbeat(FOC_t *foc, q16_t id_A_q16, q16_t iq_A_q16,
+		q16_t Id_ref_A_q16, q16_t Iq_ref_A_q16, int32_t omega_t32, q16_t lim,
+		q16_t *ud_out, q16_t *uq_out)
+{
+	q16_t ud, uq;
+	foc_dq_predict(foc, id_A_q16, iq_A_q16, Id_ref_A_q16, Iq_ref_A_q16,
+			omega_t32, foc->db_gain_q16, &ud, &uq);
+	ud = foc_clamp_q16(ud, lim);
+	*ud_out = ud;
+	*uq_out = foc_clamp_q16(uq, foc_lim_q_q16(lim, ud));
+}
+
+// --- FCS-MPC：7 種類のインバータ電圧ベクトルから 1 つを選ぶ ---
+#define Q15X2_CONST(LO, HI)	((uint32_t) (uint16_t) (LO) | ((uint32_t) (uint16_t) (HI) << 16))
+
+/* スイッチング状態 (bit0=U, bit1=V, bit2=W 上側 ON) ごとの αβ 電圧（Vbus 正規化, Q1.15）
+ * アクティブベクトルは振幅 2/3、零ベクトルは 000 / 111 */
+static const q15x2_t k_mpc_vab[8] =
+{
+	Q15X2_CONST(0, 0),					/* 000 */
+	Q15X2_CONST(21845, 0),				/* U   */
+	Q15X2_CONST(-10923, 18919),			/* V   */
+	Q15X2_CONST(10923, 18919),			/* UV  */
+	Q15X2_CONST(-10923, -18919),		/* W   */
+	Q15X2_CONST(10923, -18919),			/* UW  */
+	Q15X2_CONST(-21845, 0),				/* VW  */
+	Q15X2_CONST(0, 0),					/* UVW */
+};
+
+/* 評価順（零ベクトル → 六角形を一周）。0 は 000 / 111 のどちらか */
+static const uint8_t k_mpc_order[7] = { 0, 1, 3, 2, 6, 4, 5 };
+
+static inline q16_t foc_abs_q16(q16_t x)
+{
+	return (x < 0) ? -x : x;
+}
+
+/* 候補 1 つの評価。d軸の項だけで最良値以上なら q軸を計算せずに打ち切る */
+static inline void foc_mpc_eval(const FOC_t *foc, uint8_t st, q16_t ud_n,
+		q16_t uq_n, q15x2_t cs, q16_t *best, uint8_t *best_s, q16_t *vd,
+		q16_t *vq)
+{
+	q15x2_t v_dq = park_q15x2(k_mpc_vab[st], cs);
+	q16_t v_d = q16_from_q15(q15x2_lo(v_dq));
+	q16_t cost = q16_mul(foc_abs_q16(q16_sub_sat(ud_n, v_d)), foc->ts_ld_q16);
+	if (cost >= *best)
+		return;
+	q16_t v_q = q16_from_q15(q15x2_hi(v_dq));
+	cost = q16_add_sat(cost,
+			q16_mul(foc_abs_q16(q16_sub_sat(uq_n, v_q)), foc->ts_lq_q16));
+	if (cost < *best)
+	{
+		*best = cost;
+		*best_s = st;
+		*vd = v_d;
+		*vq = v_q;
+	}
+}
+
+/* 予測電圧 (ud_n, uq_n)[正規化] に最も近い電圧ベクトルを選ぶ。
+ * コスト = Ts/Ld·|ud - vd| + Ts/Lq·|uq - vq|（= 2 周期後の電流誤差 |Δid| + |Δiq|）。
+ * 前回の状態から評価して良い解を先に得ておき、枝刈りを効かせる。
+ * 評価は最大 7 回（1 回 = SIMD Park 1 回＋乗算 2 回）で、ISR 内の上限サイクルが固定 */
+static inline uint8_t foc_mpc_select(const FOC_t *foc, q16_t ud_n, q16_t uq_n,
+		q15x2_t cs, q16_t *vd, q16_t *vq)
+{
+	uint8_t prev = foc->mpc_state;
+	/* 零ベクトルは前回の状態から切り替わる相が少ない方（000 / 111） */
+	uint8_t ones = (uint8_t) ((prev & 1u) + ((prev >> 1) & 1u) + (prev >> 2));
+	uint8_t zero = (ones >= 2) ? 7 : 0;
+	uint8_t first = (prev == 0 || prev == 7) ? zero : prev;
+
+	q16_t best = Q16_MAX;
+	uint8_t best_s = first;
+	*vd = 0;
+	*vq = 0;
+	foc_mpc_eval(foc, first, ud_n, uq_n, cs, &best, &best_s, vd, vq);
+	for (uint32_t k = 0; k < 7; k++)
+	{
+		uint8_t st = k_mpc_order[k] ? k_mpc_order[k] : zero;
+		if (st == first)
+			continue;
+		foc_mpc_eval(foc, st, ud_n, uq_n, cs, &best, &best_s, vd, vq);
+	}
+	return best_s;
+}
+
+/* 選んだ状態をそのまま CCR へ（周期中は切り替えない：上側 ON = ARR+1, OFF = 0） */
+static inline void foc_mpc_to_ccr(uint8_t st, uint16_t arr, uint16_t *ccr1,
+		uint16_t *ccr2, uint16_t *ccr3, uint16_t *ccr4)
+{
+	uint16_t on = (uint16_t) (arr + 1u);
+	*ccr1 = (st & 1u) ? on : 0;
+	*ccr2 = (st & 2u) ? on : 0;
+	*ccr3 = (st & 4u) ? on : 0;
+	*ccr4 = (uint16_t) (arr / 2u);
+}
+
+// --- 弱め界磁：前周期の |v_dq| が制限円の FW_V_RATIO 倍を超えたら負の Id を積む ---
+static inline void foc_fw_step(FOC_t *foc, q16_t lim)
+{
+	/* FCS-MPC は電圧ベクトルそのものを出すので |v_dq| で飽和を判定できない */
+	if (!foc->fw_enable || foc->cur_ctrl == CUR_CTRL_MPC)
+	{
+		foc->id_fw_q16 = 0;
+		return;
+	}
+	/* e > 0：電圧に余裕あり → Id を 0 へ戻す、e < 0：飽和しかけ → 負へ */
+	q16_t v = hypot_q16(foc->ud_cmd_q16, foc->uq_cmd_q16);
+	q16_t e = q16_sub_sat(q16_mul(lim, FW_V_RATIO_Q16), v);
+	q16_t id = q16_add_sat(foc->id_fw_q16, q16_mul(foc->fw_ki_dt_q16, e));
+	foc->id_fw_q16 = (id > 0) ? 0 : ((id < FW_ID_MIN_A_Q16) ? FW_ID_MIN_A_Q16 : id);
+}
+
+// --- 電流指令の円制限：Id（弱め界磁分を含む）優先で |i_dq| ≤ i_lim ---
+static inline void foc_i_limit(const FOC_t *foc, q16_t *id_ref, q16_t *iq_ref)
+{
+	q16_t id = foc_clamp_q16(q16_add_sat(*id_ref, foc->id_fw_q16),
+			foc->i_lim_q16);
+	*id_ref = id;
+	*iq_ref = foc_clamp_q16(*iq_ref, foc_lim_q_q16(foc->i_lim_q16, id));
+}
+
+// --- dq 電流 → dq 電圧指令（ソフトスタート＋電流制御＋円制限＋Vbus 正規化） ---
+// --- dq 電圧ベクトルの上限半径（Vbus 正規化）。overmod は実行中に切り替わるので毎周期ここから求める ---
+static inline q16_t foc_v_limit(const FOC_t *foc)
+{
+	return foc->overmod ? V_LIMIT_OVM_Q16 : V_LIMIT_LINEAR_Q16;
+}
+
+static inline void foc_dq_control(FOC_t *foc, q16_t id, q16_t iq,
+		const RotorFrame_t *f, q16_t *vd, q16_t *vq)
+{
+	/* 電流制御（Q16.16, SI単位）
+	 * - q16 の Id/Iq [-1..1] を 実電流[A] に変換（I_MAX_A を係数として使用）
+	 * - cur_ctrl に応じて PI（PID＋FF）またはデッドビートで Vd/Vq 指令[V]を生成
+	 *   （FCS-MPC では予測電圧に最も近い電圧ベクトルを選び、mpc_state に残す）
+	 * - 最後に 1/Vbus を掛けて正規化指令[-1..1]にする（Vbus が変わってもループゲイン一定）
+	 */
+	q16_t id_A_q16 = q16_mul(id, CONFIG_I_MAX_A_Q16);
+	q16_t iq_A_q16 = q16_mul(iq, CONFIG_I_MAX_A_Q16);
+	q16_t Id_ref_A_q16 = q16_mul(foc->Id_ref_q16, CONFIG_I_MAX_A_Q16);
+	q16_t Iq_ref_A_q16 = q16_mul(foc->Iq_ref_q16, CONFIG_I_MAX_A_Q16);
+
+	/* ソフトスタートで Iq_ref を段階的に上げる */
+	q16_t ss_gain = softstart_step(&foc->ss, foc->dt_q16);
+	Iq_ref_A_q16 = q16_mul(Iq_ref_A_q16, ss_gain);
+
+	/* ダブルアップデート：次の標本点（谷）では電流が測れないので、いまの電流と出力中の電圧から予測しておく。
+	 * FCS-MPC も上側 2 相以上 ON の状態では下側シャントで 2 相を測れないので同じ予測を使う */
+	if (CONF_PWM_DOUBLE_UPDATE || foc->cur_ctrl == CUR_CTRL_MPC)
+		foc_dq_advance(foc, id_A_q16, iq_A_q16, f->omega_t32, &foc->id_pred_q16,
+				&foc->iq_pred_q16);
+
+	q16_t lim = q16_mul(foc_v_limit(foc), foc->Vbus_q16);
+	foc_fw_step(foc, lim);
+	foc_i_limit(foc, &Id_ref_A_q16, &Iq_ref_A_q16);
+
+	if (foc->cur_ctrl == CUR_CTRL_MPC)
+	{
+		q16_t ud_n, uq_n;
+		foc_dq_predict(foc, id_A_q16, iq_A_q16, Id_ref_A_q16, Iq_ref_A_q16,
+				f->omega_t32, Q16_ONE, &ud_n, &uq_n);
+		/* 六角形の外は遠さだけ分かればよいので ±2 に丸めてから比較 */
+		ud_n = foc_clamp_q16(q16_mul(ud_n, foc->vbus_inv_q16), Q16_FRAC(2, 1));
+		uq_n = foc_clamp_q16(q16_mul(uq_n, foc->vbus_inv_q16), Q16_FRAC(2, 1));
+		foc->mpc_state = foc_mpc_select(foc, ud_n, uq_n, f->cs_q15x2, vd, vq);
+		foc->ud_cmd_q16 = q16_mul(*vd, foc->Vbus_q16);
+		foc->uq_cmd_q16 = q16_mul(*vq, foc->Vbus_q16);
+		return;
+	}
+
+	q16_t ud, uq;
+	if (foc->cur_ctrl == CUR_CTRL_DEADBEAT)
+		foc_dq_deadbeat(foc, id_A_q16, iq_A_q16, Id_ref_A_q16, Iq_ref_A_q16,
+				f->omega_t32, lim, &ud, &uq);
+	else
+		foc_dq_pi(foc, id_A_q16, iq_A_q16, Id_ref_A_q16, Iq_ref_A_q16,
+				f->omega_t32, lim, &ud, &uq);
+	foc->ud_cmd_q16 = ud;
+	foc->uq_cmd_q16 = uq;
+
+	/* [V] → Vbus 正規化（duty） */
+	*vd = q16_mul(ud, foc->vbus_inv_q16);
+	*vq = q16_mul(uq, foc->vbus_inv_q16);
+}
+
 void FOC_Init(FOC_t *foc)
 {
 	foc->Id_ref_q16 = 0;
@@ -159,152 +649,336 @@ void FOC_Init(FOC_t *foc)
 	foc->Id_i_q16 = 0;
 	foc->Iq_i_q16 = 0;
 
-	foc->Vbus_q16 = Q16_FRAC(12, 1);
+	FOC_SetVbus(foc, CONFIG_VBUS_NOM_Q16);
 	foc->v_alpha_q16 = 0;
 	foc->v_beta_q16 = 0;
+	foc->i_alpha_q16 = 0;
+	foc->i_beta_q16 = 0;
+	foc->i_a_q16 = 0;
+	foc->i_b_q16 = 0;
+
+	foc->dt_q16 = Q16_ONE;
+	foc->svpwm_mode = CONF_SVPWM_MODE;
+	foc->overmod = CONF_OVERMOD_ENABLE;
+	foc->decouple = CONF_DQ_DECOUPLE_ENABLE;
+	foc->xld_k_q16 = CONFIG_XLD_PER_TURN_Q16;
+	foc->xlq_k_q16 = CONFIG_XLQ_PER_TURN_Q16;
+	foc->psi_k_q16 = CONFIG_PSI_PER_TURN_Q16;
+	foc->cur_ctrl = CONF_CUR_CTRL_MODE;
+	foc->rs_q16 = CONFIG_RS_OHM_Q16;
+	foc->ld_fs_q16 = CONFIG_LD_FS_Q16;
+	foc->lq_fs_q16 = CONFIG_LQ_FS_Q16;
+	foc->ts_ld_q16 = q16_recip(CONFIG_LD_FS_Q16);
+	foc->ts_lq_q16 = q16_recip(CONFIG_LQ_FS_Q16);
+	foc->db_gain_q16 = DEADBEAT_GAIN_Q16;
+	foc->ud_cmd_q16 = 0;
+	foc->uq_cmd_q16 = 0;
+	foc->mpc_state = 0;
+	foc->id_pred_q16 = 0;
+	foc->iq_pred_q16 = 0;
+	foc->sense_skip = 2;
+	foc->sense_valid = 1;
+	foc->shunt_lo = 0;
+	foc->shunt_hi = 1;
+	foc->shunt_neg = 0;
+	foc_plan_push(foc);
+	foc_plan_push(foc);
+	foc->sense_counts = (uint32_t) CONF_I_ADC_MID_COUNTS
+			| ((uint32_t) CONF_I_ADC_MID_COUNTS << 16);
+	foc->fw_enable = CONF_FW_ENABLE;
+	foc->fw_ki_dt_q16 = FW_KI_DT_Q16;
+	foc->id_fw_q16 = 0;
+	foc->i_lim_q16 = FW_I_LIMIT_A_Q16;
+	foc->dtc_ccr = CONF_DTC_ENABLE ? DTC_CCR_COUNTS : 0;
+	foc->dtc_knee_inv_q16 = q16_recip(DTC_I_KNEE_Q16);
+
+	pid_q16_init(&foc->pid_d);
+	pid_q16_init(&foc->pid_q);
+	foc->pid_d.kp = FOC_PID_KP_Q16;
+	foc->pid_d.ki = FOC_PID_KI_TICK_Q16;
+	foc->pid_d.kd = 0;
+	foc->pid_d.out_min = -q16_mul(foc_v_limit(foc), foc->Vbus_q16);
+	foc->pid_d.out_max = q16_mul(foc_v_limit(foc), foc->Vbus_q16);
+	foc->pid_q = foc->pid_d;
+
+	softstart_init(&foc->ss, CONFIG_SOFTSTART_RISE_TICKS_Q16);
+	softstart_enable(&foc->ss, 1);
+	foc->u_d_prev_q16 = 0;
+	foc->u_q_prev_q16 = 0;
+}
+
+/* 測定した DC バス電圧[V]を反映する。逆数の計算を含むので低レート（~1 kHz）で呼ぶ */
+void FOC_SetVbus(FOC_t *foc, q16_t vbus_q16)
+{
+	if (vbus_q16 < CONFIG_VBUS_MIN_Q16)
+		vbus_q16 = CONFIG_VBUS_MIN_Q16;
+	foc->Vbus_q16 = vbus_q16;
+	foc->vbus_inv_q16 = q16_recip(vbus_q16);
+}
+
+/* 3相の ADC カウントから、前周期に選んだ2相で U/V をパックする（捨てた相は Kirchhoff で復元）。
+ * どの2相にも窓が無かった周期は前回の値を保持する */
+uint32_t FOC_SenseCounts(FOC_t *foc, uint16_t iu, uint16_t iv, uint16_t iw)
+{
+	if (!foc->sense_valid)
+		return foc->sense_counts;
+
+	int32_t u = iu;
+	int32_t v = iv;
+	if (foc->sense_skip == 0)
+		u = 3 * CONF_I_ADC_MID_COUNTS - (int32_t) iv - (int32_t) iw;
+	else if (foc->sense_skip == 1)
+		v = 3 * CONF_I_ADC_MID_COUNTS - (int32_t) iu - (int32_t) iw;
+	u = (u < 0) ? 0 : ((u > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : u);
+	v = (v < 0) ? 0 : ((v > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : v);
+
+	foc->sense_counts = (uint32_t) u | ((uint32_t) v << 16);
+	return foc->sense_counts;
+}
+
+/* 単シャントの 2 標本（上り側 = -i_lo, 下り側 = +i_hi または -i_hi）から3相を復元し U/V をパックする。
+ * I_DC アンプは相シャントと同じゲイン・中点で、バスから流れ出る向きを＋とする。
+ * 前周期の FOC_ShuntPlan が窓を作れなかった周期は前回の値を保持する */
+uint32_t FOC_ShuntCounts(FOC_t *foc, uint16_t s_up, uint16_t s_dn)
+{
+	if (!foc->sense_valid)
+		return foc->sense_counts;
+
+	int32_t i[3];
+	i[foc->shunt_lo] = 2 * CONF_I_ADC_MID_COUNTS - (int32_t) s_up;
+	i[foc->shunt_hi] = foc->shunt_neg ?
+			2 * CONF_I_ADC_MID_COUNTS - (int32_t) s_dn : (int32_t) s_dn;
+	i[3 - foc->shunt_lo - foc->shunt_hi] = 3 * CONF_I_ADC_MID_COUNTS
+			- i[foc->shunt_lo] - i[foc->shunt_hi];
+
+	int32_t u = i[0];
+	int32_t v = i[1];
+	u = (u < 0) ? 0 : ((u > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : u);
+	v = (v < 0) ? 0 : ((v > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : v);
+
+	foc->sense_counts = (uint32_t) u | ((uint32_t) v << 16);
+	return foc->sense_counts;
+}
+
+/* CCR の書き込みが反映先の UEV に間に合わなかった周期は、標本が 1 つ前の CCR の下で取られている。
+ * それより古い（lag ≥ 2）ときは窓の位置が分からないので保持にする */
+void FOC_SenseSelect(FOC_t *foc, uint8_t lag)
+{
+	if (lag > 1)
+	{
+		foc->sense_valid = 0;
+		return;
+	}
+
+	const FOC_SensePlan_t *p = &foc->sense_plan[lag];
+	foc->sense_skip = p->skip;
+	foc->sense_valid = p->valid;
+	foc->shunt_lo = p->lo;
+	foc->shunt_hi = p->hi;
+	foc->shunt_neg = p->neg;
+}
+
+/* ダブルアップデートの谷の周期：前周期に予測した dq 電流を今周期の座標で U/V カウントに戻す
+ * （下側シャントには電流が流れないので ADC 値の代わりに FOC_StepFromAdc へ渡す） */
+uint32_t FOC_PredictCounts(const FOC_t *foc, const RotorFrame_t *f)
+{
+	q16_t id = q16_mul(foc->id_pred_q16, CONFIG_I_MAX_INV_Q16);
+	q16_t iq = q16_mul(foc->iq_pred_q16, CONFIG_I_MAX_INV_Q16);
+	q15x2_t i_ab = inv_park_q15x2(q15x2_pack(q15_from_q16(id), q15_from_q16(iq)),
+			f->cs_q15x2);
+
+	q16_t ia, ib, ic;
+	inv_clarke_q16(q16_from_q15(q15x2_lo(i_ab)), q16_from_q15(q15x2_hi(i_ab)),
+			&ia, &ib, &ic);
+
+	/* 正規化 ±1.0 = ±2048 カウント */
+	int32_t u = CONF_I_ADC_MID_COUNTS + ((ia + 16) >> 5);
+	int32_t v = CONF_I_ADC_MID_COUNTS + ((ib + 16) >> 5);
+	u = (u < 0) ? 0 : ((u > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : u);
+	v = (v < 0) ? 0 : ((v > CONFIG_ADC_RESOLUTION_COUNTS) ? CONFIG_ADC_RESOLUTION_COUNTS : v);
+	return (uint32_t) u | ((uint32_t) v << 16);
 }
 
 void FOC_CurrentLoopStep(FOC_t *foc, q16_t i_a_q16, q16_t i_b_q16,
-		q16_t i_c_q16, q16_t theta_q16)
+		q16_t i_c_q16, const RotorFrame_t *f)
 {
 	q16_t vd;
 	q16_t vq;
-	q16_t i_alpha = i_a_q16;
-	q16_t two_ib = q16_add_sat(i_b_q16, i_b_q16);
-	q16_t sum = q16_add_sat(i_a_q16, two_ib);
-	q16_t i_beta = q16_mul(sum, Q16_INV_SQRT3);
-
-	q16_t s, c;
-	sincos_q16(theta_q16, &s, &c);
-
-	// Park
-	q16_t d1 = q16_mul(c, i_alpha);
-	q16_t d2 = q16_mul(s, i_beta);
-	q16_t id = q16_add_sat(d1, d2);
-
-	q16_t q1 = q16_mul(-s, i_alpha);
-	q16_t q2 = q16_mul(c, i_beta);
-	q16_t iq = q16_add_sat(q1, q2);
-
-       /* ブロックコメント：
-        * PID 制御（Q16.16, SI単位）
-        * - q16 の Id/Iq [-1..1] を 実電流[A] に変換（I_MAX_A を係数として使用）
-        * - PID(D-on-meas) で Vd/Vq の正規化指令[-1..1]を生成
-        * - ソフトスタート係数とスルーレート制限を適用
-        */
-       {
-               static const q16_t I_MAX_A_Q16 = (q16_t)(10 << 16); /* フルスケール電流[A]（例：10A）*/
-               static const q16_t SLEW_UP_Q16 = (1 << 16);           /* 1.0 / s */
-               static const q16_t SLEW_DN_Q16 = (3 << 16);           /* 3.0 / s */
-               static const q16_t DT_Q16      = (q16_t)((1<<16) / PWM_FREQ_HZ); /* 制御周期[s] */
-
-               static pid_q16_t pid_d, pid_q;
-               static softstart_t  ss;
-               static int          inited = 0;
-               static q16_t      u_d_prev = 0, u_q_prev = 0;
-
-               if (!inited)
-               {
-                       pid_q16_init(&pid_d);
-                       pid_q16_init(&pid_q);
-                       pid_d.kp = (3<<16); pid_d.ki = (40<<16); pid_d.kd = 0;
-                       pid_q.kp = (3<<16); pid_q.ki = (40<<16); pid_q.kd = 0;
-                       pid_d.out_min = -(1<<16); pid_d.out_max = (1<<16);
-                       pid_q.out_min = -(1<<16); pid_q.out_max = (1<<16);
-                       softstart_init(&ss, (q16_t)(0.3 * 65536)); /* 0.3s */
-                       softstart_enable(&ss, 1);
-                       inited = 1;
-               }
-
-               /* Id/Iq 実測と参照を Q16.16[A] へ変換 */
-               q16_t id_A_q16     = (q16_t)(( (int64_t)id >> 15) * I_MAX_A_Q16 >> 16);
-               q16_t iq_A_q16     = (q16_t)(( (int64_t)iq >> 15) * I_MAX_A_Q16 >> 16);
-               q16_t Id_ref_A_q16 = (q16_t)(( (int64_t)foc->Id_ref_q16 >> 15) * I_MAX_A_Q16 >> 16);
-               q16_t Iq_ref_A_q16 = (q16_t)(( (int64_t)foc->Iq_ref_q16 >> 15) * I_MAX_A_Q16 >> 16);
-
-               /* ソフトスタートで Iq_ref を段階的に上げる */
-               q16_t ss_gain = softstart_step(&ss, DT_Q16);
-               Iq_ref_A_q16 = (q16_t)(( (int64_t)Iq_ref_A_q16 * ss_gain) >> 16);
-
-               /* PID 実行（出力は正規化電圧[-1..1]の Q16.16）*/
-               q16_t u_d_q16 = pid_q16_step(&pid_d, Id_ref_A_q16, id_A_q16, DT_Q16);
-               q16_t u_q_q16 = pid_q16_step(&pid_q, Iq_ref_A_q16, iq_A_q16, DT_Q16);
-
-               /* スルーレート制限 */
-               u_d_q16 = q16_slew_step(u_d_prev, u_d_q16, SLEW_UP_Q16, SLEW_DN_Q16, DT_Q16);
-               u_q_q16 = q16_slew_step(u_q_prev, u_q_q16, SLEW_UP_Q16, SLEW_DN_Q16, DT_Q16);
-               u_d_prev = u_d_q16; u_q_prev = u_q_q16;
-
-               /* q16 へ戻す（-1..1） */
-               vd = (q16_t)(( (int64_t)u_d_q16 ) << 15);
-               vq = (q16_t)(( (int64_t)u_q_q16 ) << 15);
-               /* 逆Parkへ渡すためのローカル上書き */
-               /* 以下の逆Park計算はこの vd/vq を使用 */
-               /* 注意：既存の Ki/Kp を使わないため foc->Id_i_q16 等は以降未使用 */
-
-               /* 逆Park用にスコープ外で参照される変数名と整合させる */
-               /* vd, vq ローカルをこの後の逆Park計算に使用 */
-               /* ↓（そのまま下の逆Parkへ連続） */
-               /* fallthrough */
-       }
-
-	// 逆Park
-	q16_t a1 = q16_mul(c, vd);
-	q16_t a2 = q16_mul(-s, vq);
-	q16_t v_alpha = q16_add_sat(a1, a2);
-
-	q16_t b1 = q16_mul(s, vd);
-	q16_t b2 = q16_mul(c, vq);
-	q16_t v_beta = q16_add_sat(b1, b2);
+
+	// Clarke + Park（Q1.15 パック, sin/cos は周期ごとに1回だけ計算済みのもの）
+	q15x2_t i_ab = clarke_q15x2(
+			q15x2_pack(q15_from_q16(i_a_q16), q15_from_q16(i_b_q16)));
+	q15x2_t i_dq = park_q15x2(i_ab, f->cs_q15x2);
+	q16_t id = q16_from_q15(q15x2_lo(i_dq));
+	q16_t iq = q16_from_q15(q15x2_hi(i_dq));
+	foc->i_a_q16 = i_a_q16;
+	foc->i_b_q16 = i_b_q16;
+
+	foc_dq_control(foc, id, iq, f, &vd, &vq);
+
+	// 逆Park（Q1.15 パック）
+	q15x2_t v_ab = inv_park_q15x2(
+			q15x2_pack(q15_from_q16(vd), q15_from_q16(vq)), f->cs_q15x2);
+	q16_t v_alpha = q16_from_q15(q15x2_lo(v_ab));
+	q16_t v_beta = q16_from_q15(q15x2_hi(v_ab));
+
+	if (foc->cur_ctrl == CUR_CTRL_MPC)
+	{
+		v_alpha = q16_from_q15(q15x2_lo(k_mpc_vab[foc->mpc_state]));
+		v_beta = q16_from_q15(q15x2_hi(k_mpc_vab[foc->mpc_state]));
+	}
 
 	foc->v_alpha_q16 = v_alpha;
 	foc->v_beta_q16 = v_beta;
 
-	// （任意）ここでセクタを参照できる
-	volatile uint8_t sector = svm_sector_from_alphabeta_q16(v_alpha, v_beta);
-	(void) sector;
 }
 
 void FOC_AlphaBetaToSVPWM(FOC_t *foc, uint16_t *ccr1, uint16_t *ccr2,
-		uint16_t *ccr3, uint16_t arr)
+		uint16_t *ccr3, uint16_t *ccr4, uint16_t arr)
 {
+	// FCS-MPC：選んだスイッチング状態を直接出力（変調しない）
+	if (foc->cur_ctrl == CUR_CTRL_MPC)
+	{
+		foc_mpc_to_ccr(foc->mpc_state, arr, ccr1, ccr2, ccr3, ccr4);
+		*ccr4 = foc_sense_plan(foc, *ccr1, *ccr2, *ccr3, arr, *ccr4);
+		return;
+	}
+
 	// vαβ から T0,T1,T2 と相デューティを生成（半キャリア正規化）
-	uint8_t sector = svm_sector_from_alphabeta_q16(foc->v_alpha_q16,
-			foc->v_beta_q16);
+	q16_t va, vb, vc;
+	inv_clarke_q16(foc->v_alpha_q16, foc->v_beta_q16, &va, &vb, &vc);
+	if (foc->overmod)
+		svpwm_overmod_abc_q16(foc->v_alpha_q16, foc->v_beta_q16, &va, &vb, &vc);
 
 	q16_t T0, T1, T2, Da, Db, Dc; // q16
-	svpwm_compute_T012_q16(foc->v_alpha_q16, foc->v_beta_q16, sector, &T0, &T1,
-			&T2, &Da, &Db, &Dc);
+	svpwm_from_abc_q16(foc->svpwm_mode, va, vb, vc, &T0, &T1, &T2, &Da, &Db,
+			&Dc);
 
 	// デューティを [0..ARR] へマップ
-	uint16_t d1 = (uint16_t) ((((int64_t) Da) * arr) >> 16);
-	uint16_t d2 = (uint16_t) ((((int64_t) Db) * arr) >> 16);
-	uint16_t d3 = (uint16_t) ((((int64_t) Dc) * arr) >> 16);
+	*ccr1 = duty_to_ccr(Da, arr);
+	*ccr2 = duty_to_ccr(Db, arr);
+	*ccr3 = duty_to_ccr(Dc, arr);
+	dtc_apply3(foc, ccr1, ccr2, ccr3, arr);
+
+	// --- CCR4（サンプルマーカ）：測定する2相とサンプル点を決める ---
+	q16_t Tmid_center = svpwm_sample_point_q16(T0, T1, T2);
+	*ccr4 = foc_sense_plan(foc, *ccr1, *ccr2, *ccr3, arr,
+			duty_to_ccr(Tmid_center, arr));
+}
 
-	*ccr1 = d1;
-	*ccr2 = d2;
-	*ccr3 = d3;
+void FOC_StepFromAdc(FOC_t *foc, uint32_t i_uv_counts, const RotorFrame_t *f,
+		uint16_t arr, FOC_Pwm_t *pwm)
+{
+	// 中点除去＋Clarke＋Park（Q1.15 パック, 1回だけ）
+	q15x2_t i_uv = q15x2_from_adc12(i_uv_counts, CONF_I_ADC_MID_COUNTS);
+	q15x2_t i_ab = clarke_q15x2(i_uv);
+	q15x2_t i_dq = park_q15x2(i_ab, f->cs_q15x2);
+	foc->i_alpha_q16 = q16_from_q15(q15x2_lo(i_ab));
+	foc->i_beta_q16 = q16_from_q15(q15x2_hi(i_ab));
+	foc->i_a_q16 = q16_from_q15(q15x2_lo(i_uv));
+	foc->i_b_q16 = q16_from_q15(q15x2_hi(i_uv));
+
+	q16_t vd, vq;
+	foc_dq_control(foc, q16_from_q15(q15x2_lo(i_dq)),
+			q16_from_q15(q15x2_hi(i_dq)), f, &vd, &vq);
+
+	if (foc->cur_ctrl == CUR_CTRL_MPC)
+	{
+		foc->v_alpha_q16 = q16_from_q15(q15x2_lo(k_mpc_vab[foc->mpc_state]));
+		foc->v_beta_q16 = q16_from_q15(q15x2_hi(k_mpc_vab[foc->mpc_state]));
+		foc_mpc_to_ccr(foc->mpc_state, arr, &pwm->ccr1, &pwm->ccr2,
+				&pwm->ccr3, &pwm->ccr4);
+		pwm->ccr4 = foc_sense_plan(foc, pwm->ccr1, pwm->ccr2, pwm->ccr3, arr,
+				pwm->ccr4);
+		return;
+	}
 
-	// --- CCR4（サンプルマーカ）自動更新 ---
-	// 半キャリア: T0/2, T1, T2, T0/2 → 長いアクティブベクトル中央に配置
-	q16_t Tmid_center = 0;
-	if (T1 >= T2)
+	// 逆Park → 逆Clarke（1回だけ）→ デューティ
+	q15x2_t v_ab = inv_park_q15x2(
+			q15x2_pack(q15_from_q16(vd), q15_from_q16(vq)), f->cs_q15x2);
+	q16_t v_alpha = q16_from_q15(q15x2_lo(v_ab));
+	q16_t v_beta = q16_from_q15(q15x2_hi(v_ab));
+	foc->v_alpha_q16 = v_alpha;
+	foc->v_beta_q16 = v_beta;
+
+	q16_t va, vb, vc;
+	inv_clarke_q16(v_alpha, v_beta, &va, &vb, &vc);
+	if (foc->overmod)
+		svpwm_overmod_abc_q16(v_alpha, v_beta, &va, &vb, &vc);
+
+	q16_t T0, T1, T2, Da, Db, Dc;
+	svpwm_from_abc_q16(foc->svpwm_mode, va, vb, vc, &T0, &T1, &T2, &Da, &Db,
+			&Dc);
+
+	pwm->ccr1 = duty_to_ccr(Da, arr);
+	pwm->ccr2 = duty_to_ccr(Db, arr);
+	pwm->ccr3 = duty_to_ccr(Dc, arr);
+	dtc_apply3(foc, &pwm->ccr1, &pwm->ccr2, &pwm->ccr3, arr);
+	pwm->ccr4 = foc_sense_plan(foc, pwm->ccr1, pwm->ccr2, pwm->ccr3, arr,
+			duty_to_ccr(svpwm_sample_point_q16(T0, T1, T2), arr));
+}
+
+void FOC_ShuntPlan(FOC_t *foc, FOC_Pwm_t *pwm, uint16_t arr)
+{
+	int32_t c[3] = { pwm->ccr1, pwm->ccr2, pwm->ccr3 };
+	uint16_t *up[3] = { &pwm->ccr1, &pwm->ccr2, &pwm->ccr3 };
+	uint16_t *dn[3] = { &pwm->ccr1_dn, &pwm->ccr2_dn, &pwm->ccr3_dn };
+
+	// 並び替え（c[hi] ≥ c[mid] ≥ c[lo]）
+	uint8_t hi = 0, mid = 1, lo = 2, x;
+	if (c[mid] > c[hi])
 	{
-		Tmid_center = q16_add_sat(q16_mul(T0, Q16_HALF), q16_mul(T1, Q16_HALF));
+		x = hi;
+		hi = mid;
+		mid = x;
 	}
-	else
+	if (c[lo] > c[mid])
 	{
-		q16_t t0h = q16_mul(T0, Q16_HALF);
-		q16_t t2h = q16_mul(T2, Q16_HALF);
-		Tmid_center = q16_add_sat(q16_add_sat(t0h, T1), t2h);
+		x = mid;
+		mid = lo;
+		lo = x;
+		if (c[mid] > c[hi])
+		{
+			x = hi;
+			hi = mid;
+			mid = x;
+		}
 	}
 
-	// セーフティマージン（例：2%）
-	q16_t margin = Q16_MARGIN_2PCT;
-	// 必要なら Tmid_center にマージン調整を加える（ここでは中心不変）
+	int32_t settle = DTG_TICKS + duty_to_ccr(Q16_MARGIN_2PCT, arr);
+	int32_t half = (settle + SHUNT1_ACQ_COUNTS + 1) / 2;
+	uint8_t up_on = (uint8_t) ((1u << hi) | (1u << mid));
+	uint8_t dn_on;
+	int32_t t;
+	if (c[hi] - c[lo] >= 2 * half)
+	{
+		// 上り：hi,mid ON → -i_lo ／ 下り：hi のみ ON → +i_hi（mid だけを ±acq ずらせば済む）
+		foc->shunt_neg = 0;
+		dn_on = (uint8_t) (1u << hi);
+		t = c[mid];
+		t = (t < c[lo] + half) ? c[lo] + half : ((t > c[hi] - half) ? c[hi] - half : t);
+	}
+	else
+	{
+		// 零ベクトル近傍：上り：hi,mid ON → -i_lo ／ 下り：mid,lo ON → -i_hi
+		foc->shunt_neg = 1;
+		dn_on = (uint8_t) ((1u << mid) | (1u << lo));
+		t = c[mid] - half;
+	}
+	t = (t < 1) ? 1 : ((t > (int32_t) arr - 1) ? (int32_t) arr - 1 : t);
 
-	uint16_t c4 = (uint16_t) ((((int64_t) Tmid_center) * arr) >> 31);
-	FW_SetSampleMarker(c4);
+	uint8_t ok = 1;
+	for (uint8_t k = 0; k < 3; k++)
+	{
+		uint8_t u_on = (up_on >> k) & 1u;
+		uint8_t d_on = (dn_on >> k) & 1u;
+		ok &= foc_shunt_apply(c[k], foc_shunt_shift(c[k], t, u_on, d_on, settle),
+				t, u_on, d_on, settle, (int32_t) arr + 1, up[k], dn[k]);
+	}
 
-	(void)margin;
+	foc->shunt_lo = lo;
+	foc->shunt_hi = hi;
+	foc->sense_valid = ok;
+	foc_plan_store(foc);	/* 同じ周期に FOC_StepFromAdc が積んだ [0] を単シャントの読み方で置き換える */
+	pwm->ccr4 = (uint16_t) t;
 }
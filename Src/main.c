@@ -19,6 +19,7 @@
 #include "config.h"
 #include "firmware.h"
 #include "app.h"
+#include "bench.h"
 
 extern volatile uint8_t count_flag;
 
@@ -30,11 +31,22 @@ int main(void)
 	FW_TIM3_InitBridge();
 	FW_TIM7_Init();
 
+#if CONF_BENCH_ENABLE
+	// ベンチマークのみ実行（PWM は出さない）。結果は g_bench をデバッガで読む
+	BENCH_Run();
+	while (1)
+	{
+	}
+#endif
+
 	APP_Init();
 
 	// サンプル位相：周期中央
 	FW_SetSampleMarker((uint16_t) (TIM1_ARR / 2));
 
+	// 電流（injected）・電圧（regular＋DMA）。完了割り込みがアプリ層を呼ぶので APP_Init の後
+	FW_ADC1_Init();
+
 	FW_StartAll();
 
 	while (1)
@@ -42,7 +54,10 @@ int main(void)
 		if(count_flag == 1)
 		{
 			count_flag = 0;
+			APP_Background();
+#if !CONF_CTRL_SYNC_ISR
 			APP_Step();
+#endif
 		}
 	}
 }
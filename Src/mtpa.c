@@ -0,0 +1,82 @@
+/* mtpa.c
+ * 目的：
+ *   MTPA テーブルの生成と補間。
+ *   T ∝ ψ·iq + (Ld - Lq)·id·iq を |is| 一定で最大にする Id は
+ *     id = (k - √(k² + 8·is²)) / 4,  k = ψ / (Lq - Ld)
+ *   桁あふれを避けるため r = is/k を使った同値な形で Q16.16 のまま求める。
+ *     r ≤ 1：id = -2·is·r / (1 + √(1 + 8·r²))
+ *     r > 1：id = -2·is / (u + √(u² + 8)),  u = 1/r（r → ∞ で -is/√2）
+ *   どちらも途中の値は 2·is と 9 以下に収まる。Lq ≤ Ld（表面磁石）では Id = 0。
+ */
+
+#include "mtpa.h"
+#include "config.h"
+
+
+#define MTPA_I_FS_MAX_Q16	Q16_FRAC(16384, 1)		/* 2·is が Q16 に収まる上限 */
+
+
+void MTPA_InitMotor(MTPA_t *m, q16_t i_fs_A_q16, int32_t psi_uwb,
+		int32_t ld_uh, int32_t lq_uh)
+{
+	/* k = ψ / (Lq - Ld) [A]（µWb / µH） */
+	int64_t dl = (int64_t) lq_uh - ld_uh;
+	int64_t k = (dl > 0) ? ((int64_t) psi_uwb << Q16_FBITS) / dl : 0;
+	uint8_t ipm = (dl > 0 && k >= 0 && k <= Q16_MAX && i_fs_A_q16 > 0
+			&& i_fs_A_q16 < MTPA_I_FS_MAX_Q16);
+
+	for (uint32_t i = 0; i < MTPA_N; i++)
+	{
+		q16_t is = Q16_FRAC(i, MTPA_N - 1);
+		q16_t id = 0;
+		if (ipm && i > 0)
+		{
+			q16_t is_A = q16_mul(is, i_fs_A_q16);
+			q16_t id_A;
+			if (is_A <= (q16_t) k)
+			{
+				q16_t r = q16_div(is_A, (q16_t) k);
+				q16_t s = q16_sqrt(Q16_ONE + 8 * q16_mul(r, r));
+				id_A = -q16_div(2 * q16_mul(is_A, r), Q16_ONE + s);
+			}
+			else
+			{
+				q16_t u = q16_div((q16_t) k, is_A);
+				q16_t s = q16_sqrt(q16_mul(u, u) + 8 * Q16_ONE);
+				id_A = -q16_div(2 * is_A, u + s);
+			}
+			id = q16_div(id_A, i_fs_A_q16);
+		}
+		m->id_q16[i] = id;
+		m->iq_q16[i] = q16_sqrt(q16_mul(is, is) - q16_mul(id, id));
+	}
+}
+
+void MTPA_Init(MTPA_t *m, q16_t i_fs_A_q16)
+{
+	MTPA_InitMotor(m, i_fs_A_q16, MOTOR_PSI_UWB, MOTOR_LD_UH, MOTOR_LQ_UH);
+}
+
+/* is の符号はトルクの向き（Iq の符号）。|is| > 1.0 は端点で飽和 */
+void MTPA_Lookup(const MTPA_t *m, q16_t is_q16, q16_t *id_q16, q16_t *iq_q16)
+{
+	/* 負側は先に -1 へ丸めてから反転する（Q16_MIN の符号反転はオーバーフロー） */
+	q16_t a = (is_q16 < -Q16_ONE) ? Q16_ONE : ((is_q16 < 0) ? -is_q16 : is_q16);
+	if (a > Q16_ONE)
+		a = Q16_ONE;
+
+	int32_t x = a * (MTPA_N - 1);
+	int32_t i = x >> Q16_FBITS;
+	q16_t f = x & (Q16_ONE - 1);
+	if (i >= MTPA_N - 1)
+	{
+		i = MTPA_N - 2;
+		f = Q16_ONE;
+	}
+
+	*id_q16 = q16_add_sat(m->id_q16[i],
+			q16_mul(f, m->id_q16[i + 1] - m->id_q16[i]));
+	q16_t iq = q16_add_sat(m->iq_q16[i],
+			q16_mul(f, m->iq_q16[i + 1] - m->iq_q16[i]));
+	*iq_q16 = (is_q16 < 0) ? -iq : iq;
+}
@@ -0,0 +1,252 @@
+/* trig.c
+ * 目的：
+ *   sin/cos の高速計算。角度は turn-Q16（1.0 = 1回転）。
+ *   - SINCOS_ENGINE_CORDIC : atan(2^-i) を事前計算したテーブルで回転モード CORDIC
+ *   - SINCOS_ENGINE_LUT    : 1/4波 sin テーブル（257点）＋線形補間
+ *   atan2 / 大きさは同じ atan テーブルを使うベクトルモード CORDIC で求める。
+ * 注意：
+ *   内部角は 2^32 = 1 turn の符号なし整数で扱い、折り返しは整数オーバーフローに任せる。
+ */
+
+#include "config.h"
+#include "trig.h"
+
+
+/* ====== CORDIC 係数（すべて事前計算済み整数） ====== */
+#define CORDIC_ITERS		16
+#define CORDIC_K_Q30		652032874		/* Π cos(atan(2^-i)) ≈ 0.607252935 (Q30) */
+
+/* atan(2^-i)/(2π) を 2^32 = 1 turn で表したテーブル */
+static const int32_t k_cordic_atan_turn32[CORDIC_ITERS] =
+{
+	536870912, 316933406, 167458907, 85004756,
+	42667331, 21354465, 10679838, 5340245,
+	2670163, 1335087, 667544, 333772,
+	166886, 83443, 41722, 20861
+};
+
+#if (CONF_SINCOS_ENGINE == SINCOS_ENGINE_LUT)
+/* sin(k·(π/2)/256), k=0..256（Q16.16） */
+#define SIN_LUT_BITS		8
+static const q16_t k_sin_lut_q16[(1 << SIN_LUT_BITS) + 1] =
+{
+	0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+	3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+	6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+	9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+	12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+	15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+	19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+	22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+	25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+	30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+	33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+	36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+	39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+	41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+	44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+	46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+	48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+	50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+	52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+	54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+	56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+	57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+	59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+	60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+	61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+	62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+	63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+	64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+	64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+	65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+	65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+	65536
+};
+
+/* 1/4 turn 内の角 r（0..2^30）に対する sin を線形補間 */
+static inline q16_t sin_quarter_lut_q16(uint32_t r)
+{
+	uint32_t idx = r >> (30 - SIN_LUT_BITS);
+	int32_t frac = (int32_t) ((r >> (30 - SIN_LUT_BITS - 16)) & 0xFFFF);
+	if (idx >= (1 << SIN_LUT_BITS))
+		return k_sin_lut_q16[1 << SIN_LUT_BITS];
+	q16_t y0 = k_sin_lut_q16[idx];
+	q16_t dy = k_sin_lut_q16[idx + 1] - y0;
+	return y0 + ((dy * frac + (1 << 15)) >> 16);
+}
+
+void sincos_turn32(turn32_t t, q16_t *s, q16_t *c)
+{
+	uint32_t quad = t >> 30;
+	uint32_t r = t & 0x3FFFFFFF;
+	q16_t sr = sin_quarter_lut_q16(r);
+	q16_t cr = sin_quarter_lut_q16(0x40000000 - r);
+
+	switch (quad)
+	{
+	case 0:
+		*s = sr;
+		*c = cr;
+		break;
+	case 1:
+		*s = cr;
+		*c = -sr;
+		break;
+	case 2:
+		*s = -sr;
+		*c = -cr;
+		break;
+	default:
+		*s = -cr;
+		*c = sr;
+		break;
+	}
+}
+
+#else
+void sincos_turn32(turn32_t t, q16_t *s, q16_t *c)
+{
+	/* ±1/4 turn へ折り畳み（半回転ずらした分は符号反転で戻す） */
+	int32_t z = (int32_t) t;
+	int8_t flip = 0;
+	if (z > 0x40000000 || z < -0x40000000)
+	{
+		z = (int32_t) (t + 0x80000000u);
+		flip = 1;
+	}
+
+	int32_t x = CORDIC_K_Q30; /* cos */
+	int32_t y = 0; /* sin */
+
+	for (int i = 0; i < CORDIC_ITERS; i++)
+	{
+		int32_t dx = (y >> i);
+		int32_t dy = (x >> i);
+		if (z >= 0)
+		{
+			x -= dx;
+			y += dy;
+			z -= k_cordic_atan_turn32[i];
+		}
+		else
+		{
+			x += dx;
+			y -= dy;
+			z += k_cordic_atan_turn32[i];
+		}
+	}
+
+	/* Q30 → Q16（丸め） */
+	x = (x + (1 << 13)) >> 14;
+	y = (y + (1 << 13)) >> 14;
+	if (flip)
+	{
+		x = -x;
+		y = -y;
+	}
+	*s = y;
+	*c = x;
+}
+#endif
+
+void sincos_q16(q16_t th, q16_t *s, q16_t *c)
+{
+	/* turn-Q16 の小数部がそのまま1回転内の位置 */
+	sincos_turn32((turn32_t) th << Q16_FBITS, s, c);
+}
+
+/* ベクトルモード CORDIC：(x, y) → 大きさ（Q16）と角度（2^32 = 1 turn） */
+static void cordic_vectoring(q16_t x_in, q16_t y_in, q16_t *mag, uint32_t *ang)
+{
+	uint32_t ux = (x_in < 0) ? (uint32_t) (-(int64_t) x_in) : (uint32_t) x_in;
+	uint32_t uy = (y_in < 0) ? (uint32_t) (-(int64_t) y_in) : (uint32_t) y_in;
+	if ((ux | uy) == 0)
+	{
+		*mag = 0;
+		*ang = 0;
+		return;
+	}
+
+	/* 最大成分が 2^28 付近になるよう正規化（ゲイン 1.647·√2 でも溢れない） */
+	int sh = __builtin_clz(ux | uy) - 3;
+	int32_t x, y;
+	if (sh >= 0)
+	{
+		x = x_in << sh;
+		y = y_in << sh;
+	}
+	else
+	{
+		x = x_in >> -sh;
+		y = y_in >> -sh;
+	}
+
+	/* 左半面は半回転して右半面へ */
+	uint32_t z = 0;
+	if (x < 0)
+	{
+		x = -x;
+		y = -y;
+		z = 0x80000000u;
+	}
+
+	for (int i = 0; i < CORDIC_ITERS; i++)
+	{
+		int32_t dx = (y >> i);
+		int32_t dy = (x >> i);
+		if (y > 0)
+		{
+			x += dx;
+			y -= dy;
+			z += (uint32_t) k_cordic_atan_turn32[i];
+		}
+		else
+		{
+			x -= dx;
+			y += dy;
+			z -= (uint32_t) k_cordic_atan_turn32[i];
+		}
+	}
+
+	/* CORDIC ゲインを除去して元のスケールへ戻す */
+	int64_t m = ((int64_t) x * CORDIC_K_Q30) >> 30;
+	if (sh >= 0)
+		m = (m + (((int64_t) 1 << sh) >> 1)) >> sh;
+	else
+		m <<= -sh;
+	*mag = (m > (int64_t) Q16_MAX) ? Q16_MAX : (q16_t) m;
+	*ang = z;
+}
+
+q16_t atan2_turn_q16(q16_t y, q16_t x)
+{
+	q16_t mag;
+	uint32_t ang;
+	cordic_vectoring(x, y, &mag, &ang);
+	return (q16_t) ((int32_t) (ang + (1u << 15)) >> Q16_FBITS);
+}
+
+turn32_t atan2_turn32(q16_t y, q16_t x)
+{
+	q16_t mag;
+	uint32_t ang;
+	cordic_vectoring(x, y, &mag, &ang);
+	return ang;
+}
+
+q16_t hypot_q16(q16_t x, q16_t y)
+{
+	q16_t mag;
+	uint32_t ang;
+	cordic_vectoring(x, y, &mag, &ang);
+	return mag;
+}
+
+void cart2polar_q16(q16_t x, q16_t y, q16_t *mag, q16_t *th)
+{
+	uint32_t ang;
+	cordic_vectoring(x, y, mag, &ang);
+	*th = (q16_t) ((int32_t) (ang + (1u << 15)) >> Q16_FBITS);
+}